@@ -33,7 +33,7 @@ class Player : public QMPwidget
 
 	public:
 		Player(const QStringList &args, const QString &url, QWidget *parent = 0)
-			: QMPwidget(parent), m_url(url)
+			: QMPwidget(parent), m_url(url), m_loadPending(true)
 		{
 			connect(this, SIGNAL(stateChanged(int)), this, SLOT(stateChanged(int)));
 			QMPwidget::start(args);
@@ -42,8 +42,13 @@ class Player : public QMPwidget
 	private slots:
 		void stateChanged(int state)
 		{
+			// The process is started asynchronously, so it may become ready
+			// before or after the widget has been shown
 			if (state == QMPwidget::NotStartedState) {
 				QApplication::exit();
+			} else if (state == QMPwidget::IdleState && m_loadPending && isVisible()) {
+				m_loadPending = false;
+				QMPwidget::load(m_url);
 			} else if (state == QMPwidget::PlayingState && mediaInfo().ok) {
 				if (parentWidget()) {
 					parentWidget()->resize(mediaInfo().size.width(), mediaInfo().size.height());
@@ -56,7 +61,8 @@ class Player : public QMPwidget
 	protected:
 		void showEvent(QShowEvent *event)
 		{
-			if (!event->spontaneous() && state() == QMPwidget::IdleState) {
+			if (!event->spontaneous() && m_loadPending && state() == QMPwidget::IdleState) {
+				m_loadPending = false;
 				QMPwidget::load(m_url);
 			}
 		}
@@ -76,6 +82,7 @@ class Player : public QMPwidget
 
 	private:
 		QString m_url;
+		bool m_loadPending;
 };
 
 
@@ -4,6 +4,6 @@
 #
 
 TEMPLATE = subdirs
-SUBDIRS += src demo
+SUBDIRS += src demo tests
 
 CONFIG += ordered
@@ -0,0 +1,373 @@
+/*
+ *  qmpwidget - A Qt widget for embedding MPlayer
+ *  Copyright (C) 2010 by Jonas Gehring
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef QMPCAPABILITIES_H_
+#define QMPCAPABILITIES_H_
+
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QHash>
+#include <QProcess>
+#include <QRegExp>
+#include <QSettings>
+#include <QStringList>
+#include <QTime>
+
+
+// Capabilities of an MPlayer executable
+class QMPCapabilities
+{
+	public:
+		QMPCapabilities()
+			: valid(false), mtime(0), nodefaultBindings(false), preciseSeek(false)
+		{
+
+		}
+
+		bool valid;
+		uint mtime;
+
+		QString version;
+		QStringList videoOutputs;
+		bool nodefaultBindings;
+		bool preciseSeek;
+		QStringList keys;
+};
+
+
+// Internal process-wide cache of MPlayer capabilities, keyed by the path of
+// the executable and its modification time. Unknown executables are probed by
+// running them with "-version", "-vo help", "-input keylist" and
+// "-input cmdlist" in parallel, without blocking the event loop. Optionally, the results are stored using
+// QSettings, so they survive application restarts.
+class QMPCapabilityCache : public QObject
+{
+	Q_OBJECT
+
+	public:
+		// Returns the global instance
+		static QMPCapabilityCache *instance()
+		{
+			static QMPCapabilityCache *cache = NULL;
+			if (cache == NULL) {
+				cache = new QMPCapabilityCache(QCoreApplication::instance());
+			}
+			return cache;
+		}
+
+		// Returns true if up-to-date capabilities of the given executable are
+		// known, i.e. if capabilities() won't need to wait
+		bool contains(const QString &path)
+		{
+			QString file = resolve(path);
+			return (m_cache.contains(file) && m_cache[file].mtime == modificationTime(file));
+		}
+
+		// Returns the capabilities of the given executable. If they are not
+		// known yet, a probe will be started, and the function either returns
+		// invalid capabilities or waits for the probe if \p wait is true.
+		// Waiting is limited to \p timeout milliseconds, after which the probe
+		// continues in the background and invalid capabilities are returned.
+		QMPCapabilities capabilities(const QString &path, bool wait = false, int timeout = 3000)
+		{
+			probe(path);
+
+			QString file = resolve(path);
+			if (wait) {
+				// The probe will be finished and removed by the last process
+				QTime time;
+				time.start();
+				for (int i = 0; i < Probe::NumProcesses && m_probes.contains(file); i++) {
+					QProcess *p = m_probes[file]->processes[i];
+					int remaining = timeout - time.elapsed();
+					if (p->state() != QProcess::NotRunning && (remaining <= 0 || !p->waitForFinished(remaining))) {
+						break;
+					}
+				}
+				if (m_probes.contains(file) && finished(m_probes[file])) {
+					finish(file);
+				}
+			}
+			return m_cache.value(file);
+		}
+
+		// Returns true if the given executable is being probed
+		bool isProbing(const QString &path)
+		{
+			return m_probes.contains(resolve(path));
+		}
+
+		// Starts probing the given executable in the background, unless its
+		// capabilities are known already (or have been stored on disk).
+		// probed() will be emitted once the probe has finished.
+		void probe(const QString &path)
+		{
+			QString file = resolve(path);
+			if (m_probes.contains(file) || contains(path) || restore(file)) {
+				return;
+			}
+
+			Probe *probe = new Probe();
+			probe->path = path;
+			probe->mtime = modificationTime(file);
+			QStringList args[Probe::NumProcesses];
+			args[0] << "-version";
+			args[1] << "-vo" << "help";
+			args[2] << "-input" << "keylist";
+			args[3] << "-input" << "cmdlist";
+			for (int i = 0; i < Probe::NumProcesses; i++) {
+				QProcess *p = new QProcess(this);
+				p->setProperty("qmp_probe", file);
+				connect(p, SIGNAL(finished(int, QProcess::ExitStatus)), this, SLOT(processFinished()));
+				connect(p, SIGNAL(error(QProcess::ProcessError)), this, SLOT(processFinished()));
+				probe->processes[i] = p;
+			}
+			m_probes.insert(file, probe);
+
+			for (int i = 0; i < Probe::NumProcesses; i++) {
+				probe->processes[i]->start(path, args[i]);
+			}
+		}
+
+		// Enables storing the capabilities on disk
+		void setPersistent(bool persistent)
+		{
+			m_persistent = persistent;
+		}
+
+		bool isPersistent() const
+		{
+			return m_persistent;
+		}
+
+	signals:
+		void probed(const QString &path);
+
+	private slots:
+		void processFinished()
+		{
+			QProcess *p = qobject_cast<QProcess *>(sender());
+			QString file = p->property("qmp_probe").toString();
+			if (!m_probes.contains(file)) {
+				return;
+			}
+
+			// Both error() and finished() may be emitted for a process
+			Probe *probe = m_probes[file];
+			if (p->state() != QProcess::NotRunning || probe->done.contains(p)) {
+				return;
+			}
+			probe->done.append(p);
+			if (probe->done.count() == Probe::NumProcesses) {
+				finish(file);
+			}
+		}
+
+	private:
+		QMPCapabilityCache(QObject *parent = 0)
+			: QObject(parent), m_persistent(false)
+		{
+
+		}
+
+		~QMPCapabilityCache()
+		{
+			qDeleteAll(m_probes);
+		}
+
+		struct Probe {
+			enum {
+				NumProcesses = 4
+			};
+
+			QString path;
+			uint mtime;
+			QProcess *processes[NumProcesses];
+			QList<QProcess *> done;
+		};
+
+		static bool finished(const Probe *probe)
+		{
+			for (int i = 0; i < Probe::NumProcesses; i++) {
+				if (probe->processes[i]->state() != QProcess::NotRunning) {
+					return false;
+				}
+			}
+			return true;
+		}
+
+		// Collects the probe results and stores them
+		void finish(const QString &file)
+		{
+			Probe *probe = m_probes.take(file);
+
+			QMPCapabilities caps;
+			caps.mtime = probe->mtime;
+			QString output = QString::fromLocal8Bit(probe->processes[0]->readAllStandardOutput());
+			if (!output.isEmpty()) {
+				caps.valid = true;
+				QRegExp re("MPlayer ([^ ]*)");
+				caps.version = (re.indexIn(output) > -1 ? re.cap(1) : output);
+			}
+
+			// "-input nodefault-bindings" is available since r28878
+			QRegExp svn("SVN-r([0-9]*)");
+			if (svn.indexIn(caps.version) > -1 && svn.cap(1).toInt() >= 28878) {
+				caps.nodefaultBindings = true;
+			}
+
+			// The driver list is indented, with one driver per line
+			QStringList lines = QString::fromLocal8Bit(probe->processes[1]->readAllStandardOutput()).split("\n", QString::SkipEmptyParts);
+			bool list = false;
+			for (int i = 0; i < lines.count(); i++) {
+				if (lines[i].startsWith("Available video output drivers")) {
+					list = true;
+				} else if (list && (lines[i].startsWith(' ') || lines[i].startsWith('\t'))) {
+					QString driver = lines[i].trimmed().section(QRegExp("\\s"), 0, 0);
+					if (!driver.isEmpty()) {
+						caps.videoOutputs.append(driver);
+					}
+				}
+			}
+
+			lines = QString::fromLocal8Bit(probe->processes[2]->readAllStandardOutput()).split("\n", QString::SkipEmptyParts);
+			for (int i = 0; i < lines.count(); i++) {
+				QString key = lines[i].trimmed();
+				if (!key.isEmpty()) {
+					caps.keys.append(key);
+				}
+			}
+
+			// The command list contains the argument types of each command.
+			// Builds with precise seeking accept a third argument for seek,
+			// e.g. "seek Float [Integer] [Integer]", while MPlayer 1.x
+			// only knows two and seeks to keyframes.
+			lines = QString::fromLocal8Bit(probe->processes[3]->readAllStandardOutput()).split("\n", QString::SkipEmptyParts);
+			for (int i = 0; i < lines.count(); i++) {
+				QStringList words = lines[i].simplified().split(' ');
+				if (words.first() == "seek") {
+					caps.preciseSeek = (words.count() > 3);
+					break;
+				}
+			}
+
+			for (int i = 0; i < Probe::NumProcesses; i++) {
+				probe->processes[i]->deleteLater();
+			}
+
+			// Failed probes aren't cached, so the executable will be probed
+			// again, e.g. after it has been installed or made executable
+			if (caps.valid) {
+				m_cache.insert(file, caps);
+				if (m_persistent) {
+					store(file, caps);
+				}
+			} else {
+				m_cache.remove(file);
+			}
+			emit probed(probe->path);
+			delete probe;
+		}
+
+		// Loads stored capabilities, if they are up to date
+		bool restore(const QString &file)
+		{
+			if (!m_persistent) {
+				return false;
+			}
+
+			QSettings settings("qmpwidget", "qmpwidget");
+			settings.beginGroup(settingsGroup(file));
+			if (settings.value("path").toString() != file || settings.value("mtime").toUInt() != modificationTime(file)) {
+				return false;
+			}
+
+			QMPCapabilities caps;
+			caps.valid = true;
+			caps.mtime = settings.value("mtime").toUInt();
+			caps.version = settings.value("version").toString();
+			caps.videoOutputs = settings.value("videoOutputs").toStringList();
+			caps.nodefaultBindings = settings.value("nodefaultBindings").toBool();
+			caps.preciseSeek = settings.value("preciseSeek").toBool();
+			caps.keys = settings.value("keys").toStringList();
+			m_cache.insert(file, caps);
+			return true;
+		}
+
+		// Stores capabilities on disk
+		void store(const QString &file, const QMPCapabilities &caps)
+		{
+			QSettings settings("qmpwidget", "qmpwidget");
+			settings.beginGroup(settingsGroup(file));
+			settings.setValue("path", file);
+			settings.setValue("mtime", caps.mtime);
+			settings.setValue("version", caps.version);
+			settings.setValue("videoOutputs", caps.videoOutputs);
+			settings.setValue("nodefaultBindings", caps.nodefaultBindings);
+			settings.setValue("preciseSeek", caps.preciseSeek);
+			settings.setValue("keys", caps.keys);
+		}
+
+		static QString settingsGroup(const QString &file)
+		{
+			return QString("capabilities/%1").arg(qHash(file));
+		}
+
+		// Returns the absolute path of an executable, searching PATH if needed
+		static QString resolve(const QString &path)
+		{
+			if (path.contains('/') || path.contains('\\')) {
+				return QFileInfo(path).absoluteFilePath();
+			}
+
+#ifdef Q_WS_WIN
+			QStringList dirs = QString::fromLocal8Bit(qgetenv("PATH")).split(';', QString::SkipEmptyParts);
+			QStringList names = QStringList(path) << path + ".exe";
+#else
+			QStringList dirs = QString::fromLocal8Bit(qgetenv("PATH")).split(':', QString::SkipEmptyParts);
+			QStringList names = QStringList(path);
+#endif
+			for (int i = 0; i < dirs.count(); i++) {
+				for (int j = 0; j < names.count(); j++) {
+					QFileInfo info(QDir(dirs[i]), names[j]);
+					if (info.isFile() && info.isExecutable()) {
+						return info.absoluteFilePath();
+					}
+				}
+			}
+			return path;
+		}
+
+		static uint modificationTime(const QString &file)
+		{
+			QFileInfo info(file);
+			return (info.exists() ? info.lastModified().toTime_t() : 0);
+		}
+
+	private:
+		QHash<QString, QMPCapabilities> m_cache;
+		QHash<QString, Probe *> m_probes;
+		bool m_persistent;
+};
+
+
+#endif // QMPCAPABILITIES_H_
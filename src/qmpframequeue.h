@@ -0,0 +1,544 @@
+/*
+ *  qmpwidget - A Qt widget for embedding MPlayer
+ *  Copyright (C) 2010 by Jonas Gehring
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef QMPFRAMEQUEUE_H_
+#define QMPFRAMEQUEUE_H_
+
+
+#include <QImage>
+#include <QMutex>
+#include <QObject>
+#include <QSharedPointer>
+#include <QSize>
+#include <QTimer>
+#include <QVector>
+#include <QWaitCondition>
+
+#include "qmpstatistics.h"
+#include "qmpwidget.h"
+
+
+// A single frame buffer
+class QMPFrame
+{
+	public:
+		enum State {
+			FreeState = 0,
+			WritingState,
+			ReadyState,
+			DisplayedState
+		};
+
+		// Frames are either converted to RGB or contain the raw Y, Cb and Cr
+		// planes, which is used if the video widget can convert them itself
+		enum Format {
+			RgbFormat = 0,
+			YuvFormat
+		};
+
+		QMPFrame()
+			: state(FreeState), number(0), time(-1), format(RgbFormat), width(0), height(0), cwidth(0), cheight(0)
+		{
+
+		}
+
+		// Returns a pointer to the given plane of YUV frames
+		uchar *plane(int i)
+		{
+			switch (i) {
+				case 0: return yuv.data();
+				case 1: return yuv.data() + width * height;
+				default: return yuv.data() + width * height + cwidth * cheight;
+			}
+		}
+
+		State state;
+		quint64 number;
+		qint64 time; // Presentation time in milliseconds, or -1 if unknown
+		Format format;
+
+		QImage image;
+		QVector<uchar> yuv;
+		int width, height;
+		int cwidth, cheight;
+};
+
+
+// Internal bounded queue of preallocated frame buffers, shared by the YUV
+// reader and the video widget. Each buffer is owned by exactly one side at any
+// time, and the frame images are never copied, so writing to a buffer doesn't
+// cause implicit sharing to detach. If the queue is full, the drop policy
+// decides what happens to new frames.
+class QMPFrameQueue : public QObject
+{
+	Q_OBJECT
+
+	public:
+		// Constructor
+		QMPFrameQueue(int size = 1, QMPwidget::FrameDropPolicy policy = QMPwidget::DropOldestFrame, QObject *parent = 0)
+			: QObject(parent), m_policy(policy), m_format(QMPFrame::RgbFormat), m_counter(0), m_dropped(0),
+			  m_notified(false), m_aborted(false)
+		{
+			setSize(size);
+		}
+
+		// Destructor
+		~QMPFrameQueue()
+		{
+			qDeleteAll(m_frames);
+		}
+
+		// Sets the maximum number of frames waiting for being displayed
+		void setSize(int size)
+		{
+			QMutexLocker locker(&m_mutex);
+			m_size = qMax(size, 1);
+
+			// Additionally, one buffer is being written and one is being displayed.
+			// Buffers are never removed, since they might be in use.
+			while (m_frames.count() < m_size + 2) {
+				m_frames.append(new QMPFrame());
+			}
+			m_freed.wakeAll();
+		}
+
+		// Sets the policy for frames that don't fit into the queue anymore
+		void setPolicy(QMPwidget::FrameDropPolicy policy)
+		{
+			QMutexLocker locker(&m_mutex);
+			m_policy = policy;
+			m_freed.wakeAll();
+		}
+
+		// Sets the format of new frames. This is decided by the video widget.
+		void setFormat(QMPFrame::Format format)
+		{
+			QMutexLocker locker(&m_mutex);
+			m_format = format;
+		}
+
+		// Sets the size of RGB frame images. If the size differs from the
+		// video size, the reader scales the frames, so the video widget can
+		// paint them without scaling. A null size means the video size.
+		void setTargetSize(const QSize &size)
+		{
+			QMutexLocker locker(&m_mutex);
+			m_targetSize = size;
+		}
+
+		// Returns the number of frames that have been dropped
+		quint64 droppedFrames()
+		{
+			QMutexLocker locker(&m_mutex);
+			return m_dropped;
+		}
+
+		// Returns a free buffer for writing a frame of the given size (with the
+		// given chroma plane size for YUV frames). If the
+		// queue is full, the behavior depends on the drop policy: The oldest
+		// frame will be reused, NULL will be returned (i.e. the new frame
+		// should be dropped) or the call blocks until a frame has been taken.
+		// NULL will also be returned if the queue has been aborted.
+		QMPFrame *acquire(int width, int height, int cwidth, int cheight)
+		{
+			QMutexLocker locker(&m_mutex);
+			QMPFrame *frame = NULL;
+			while (!m_aborted) {
+				if (numReady() < m_size) {
+					frame = nextFree();
+				} else if (m_policy == QMPwidget::DropOldestFrame) {
+					frame = oldestReady();
+					++m_dropped;
+				} else if (m_policy == QMPwidget::DropNewestFrame) {
+					++m_dropped;
+					return NULL;
+				}
+				if (frame != NULL) {
+					break;
+				}
+				m_freed.wait(&m_mutex);
+			}
+			if (frame == NULL) {
+				return NULL;
+			}
+
+			// Buffers are (re-)allocated on resolution changes only
+			QSize size = (m_targetSize.isEmpty() ? QSize(width, height) : m_targetSize);
+			frame->format = m_format;
+			frame->width = width;
+			frame->height = height;
+			frame->cwidth = cwidth;
+			frame->cheight = cheight;
+			if (m_format == QMPFrame::YuvFormat) {
+				frame->yuv.resize(width * height + 2 * cwidth * cheight);
+			} else if (frame->image.size() != size) {
+				frame->image = QImage(size, QImage::Format_RGB32);
+			}
+			frame->state = QMPFrame::WritingState;
+			return frame;
+		}
+
+		// Appends a frame that has been written to the queue
+		void publish(QMPFrame *frame)
+		{
+			m_mutex.lock();
+			frame->state = QMPFrame::ReadyState;
+			frame->number = m_counter++;
+			bool notify = !m_notified;
+			m_notified = true;
+			m_mutex.unlock();
+
+			// Only a single notification is pending at any time
+			if (notify) {
+				emit frameReady();
+			}
+		}
+
+		// Returns the presentation time of the oldest frame in the queue.
+		// Returns false if there's no frame.
+		bool nextFrameTime(qint64 *time)
+		{
+			QMutexLocker locker(&m_mutex);
+			QMPFrame *frame = oldestReady();
+			if (frame == NULL) {
+				return false;
+			}
+			*time = frame->time;
+			return true;
+		}
+
+		// Takes the oldest frame from the queue for displaying it. The frame
+		// has to be given back using release() afterwards. If \p until is
+		// given, older frames are skipped as long as a newer frame has a
+		// presentation time before it, and \p skipped is increased for each
+		// of them.
+		QMPFrame *take(qint64 until = -1, quint64 *skipped = NULL)
+		{
+			QMutexLocker locker(&m_mutex);
+			QMPFrame *frame = oldestReady();
+			while (frame != NULL && until >= 0) {
+				QMPFrame *next = nextReady(frame);
+				if (next == NULL || next->time < 0 || next->time > until) {
+					break;
+				}
+				frame->state = QMPFrame::FreeState;
+				if (skipped != NULL) {
+					++*skipped;
+				}
+				frame = next;
+			}
+			if (frame != NULL) {
+				frame->state = QMPFrame::DisplayedState;
+				m_freed.wakeAll();
+			}
+
+			// Notify again if there are more frames waiting. This is called
+			// from the GUI thread, so the signal has to be queued explicitly.
+			m_notified = (numReady() > 0);
+			if (m_notified) {
+				QMetaObject::invokeMethod(this, "frameReady", Qt::QueuedConnection);
+			}
+			return frame;
+		}
+
+		// Gives a frame back to the queue
+		void release(QMPFrame *frame)
+		{
+			QMutexLocker locker(&m_mutex);
+			frame->state = QMPFrame::FreeState;
+			m_freed.wakeAll();
+		}
+
+		// Wakes up and rejects all further acquire() calls
+		void abort()
+		{
+			QMutexLocker locker(&m_mutex);
+			m_aborted = true;
+			m_freed.wakeAll();
+		}
+
+	signals:
+		void frameReady();
+
+	private:
+		// The following functions need to be called with the mutex locked
+
+		QMPFrame *nextFree() const
+		{
+			for (int i = 0; i < m_frames.count(); i++) {
+				if (m_frames[i]->state == QMPFrame::FreeState) {
+					return m_frames[i];
+				}
+			}
+			return NULL;
+		}
+
+		QMPFrame *oldestReady() const
+		{
+			QMPFrame *oldest = NULL;
+			for (int i = 0; i < m_frames.count(); i++) {
+				if (m_frames[i]->state == QMPFrame::ReadyState && (oldest == NULL || m_frames[i]->number < oldest->number)) {
+					oldest = m_frames[i];
+				}
+			}
+			return oldest;
+		}
+
+		QMPFrame *nextReady(const QMPFrame *frame) const
+		{
+			QMPFrame *next = NULL;
+			for (int i = 0; i < m_frames.count(); i++) {
+				if (m_frames[i]->state == QMPFrame::ReadyState && m_frames[i]->number > frame->number && (next == NULL || m_frames[i]->number < next->number)) {
+					next = m_frames[i];
+				}
+			}
+			return next;
+		}
+
+		int numReady() const
+		{
+			int n = 0;
+			for (int i = 0; i < m_frames.count(); i++) {
+				if (m_frames[i]->state == QMPFrame::ReadyState) {
+					++n;
+				}
+			}
+			return n;
+		}
+
+	private:
+		QMutex m_mutex;
+		QWaitCondition m_freed;
+		QVector<QMPFrame *> m_frames;
+		int m_size;
+		QMPwidget::FrameDropPolicy m_policy;
+		QMPFrame::Format m_format;
+		QSize m_targetSize;
+		quint64 m_counter;
+		quint64 m_dropped;
+		bool m_notified;
+		bool m_aborted;
+};
+
+
+
+// Internal presentation scheduler for the video widgets. Frames are presented
+// at their presentation times, which are mapped to the monotonic clock when
+// the first frame arrives. Only one frame is presented per paint of the video
+// widget and display refresh, and frames that became due in the meantime are
+// skipped. If the stream gets out of sync (e.g. after pausing), the clock is
+// adjusted. The video widgets report the time needed for uploading and
+// painting frames to the scheduler, too.
+class QMPFrameScheduler : public QObject
+{
+	Q_OBJECT
+
+	public:
+		// Constructor
+		QMPFrameScheduler(QObject *parent = 0)
+			: QObject(parent), m_refreshInterval(1000000 / 60), m_synced(false), m_offset(0), m_presentTime(0),
+			  m_paintPending(false), m_presented(0), m_skipped(0), m_late(0)
+		{
+			m_timer.setSingleShot(true);
+			connect(&m_timer, SIGNAL(timeout()), this, SLOT(schedule()));
+		}
+
+		// Sets the queue that frames will be taken from. The counters
+		// are reset.
+		void setQueue(const QSharedPointer<QMPFrameQueue> &queue)
+		{
+			if (m_queue) {
+				disconnect(m_queue.data(), 0, this, 0);
+			}
+			m_queue = queue;
+			m_timer.stop();
+			m_synced = false;
+			m_paintPending = false;
+			m_presented = m_skipped = m_late = 0;
+			m_upload.reset();
+			m_paint.reset();
+			if (m_queue) {
+				connect(m_queue.data(), SIGNAL(frameReady()), this, SLOT(schedule()));
+				schedule();
+			}
+		}
+
+		// Sets the refresh rate of the display in Hz, i.e. the maximum number
+		// of frames presented per second. Frames presented more than a
+		// refresh interval after their presentation time are counted as late.
+		void setRefreshRate(double rate)
+		{
+			m_refreshInterval = qint64(1000000 / (rate > 0 ? rate : 60.0));
+		}
+
+		double refreshRate() const
+		{
+			return 1000000.0 / m_refreshInterval;
+		}
+
+		// Takes the frame that should be presented now. This should be
+		// called after present() has been emitted, and painted() should be
+		// called once the frame has been painted.
+		QMPFrame *take()
+		{
+			if (!m_queue) {
+				return NULL;
+			}
+
+			const qint64 now = qmpMicroseconds();
+			QMPFrame *frame = m_queue->take(m_synced ? (now - m_offset) / 1000 : -1, &m_skipped);
+			if (frame == NULL) {
+				return NULL;
+			}
+
+			++m_presented;
+			if (m_synced && frame->time >= 0 && now - (1000 * frame->time + m_offset) > m_refreshInterval) {
+				++m_late;
+			}
+			m_presentTime = now;
+			m_paintPending = true;
+
+			// Don't wait forever if the widget isn't painted, e.g. because
+			// it's hidden
+			m_timer.start(PaintTimeout);
+			return frame;
+		}
+
+		// Tells the scheduler that the last frame has been painted
+		void painted()
+		{
+			m_paintPending = false;
+			schedule();
+		}
+
+		quint64 presentedFrames() const
+		{
+			return m_presented;
+		}
+
+		quint64 skippedFrames() const
+		{
+			return m_skipped;
+		}
+
+		quint64 lateFrames() const
+		{
+			return m_late;
+		}
+
+		// Adds the time needed for uploading a frame to the GPU
+		void addUploadTime(qint64 usecs)
+		{
+			m_upload.add(usecs);
+		}
+
+		// Adds the time needed for painting a frame
+		void addPaintTime(qint64 usecs)
+		{
+			m_paint.add(usecs);
+		}
+
+		const QMPLatencyHistogram &uploadLatency() const
+		{
+			return m_upload;
+		}
+
+		const QMPLatencyHistogram &paintLatency() const
+		{
+			return m_paint;
+		}
+
+	signals:
+		// Emitted if a frame should be taken and presented
+		void present();
+
+	private slots:
+		void schedule()
+		{
+			if (!m_queue) {
+				return;
+			}
+
+			const qint64 now = qmpMicroseconds();
+			if (m_paintPending) {
+				qint64 timeout = 1000 * PaintTimeout - (now - m_presentTime);
+				if (timeout > 0) {
+					// painted() will be called
+					wakeUp(timeout);
+					return;
+				}
+				m_paintPending = false;
+			}
+
+			qint64 time;
+			if (!m_queue->nextFrameTime(&time)) {
+				return;
+			}
+
+			// At most one frame per display refresh
+			qint64 wait = m_refreshInterval - (now - m_presentTime);
+			if (time >= 0) {
+				qint64 due = 1000 * time + m_offset;
+				if (!m_synced || qAbs(due - now) > 1000 * SyncThreshold) {
+					m_offset = now - 1000 * time;
+					m_synced = true;
+					due = now;
+				}
+				wait = qMax(wait, due - now);
+			}
+
+			if (wait > 0) {
+				wakeUp(wait);
+			} else {
+				m_timer.stop();
+				emit present();
+			}
+		}
+
+	private:
+		enum {
+			PaintTimeout = 100, // ms
+			SyncThreshold = 250 // ms
+		};
+
+		// Calls schedule() after the given number of microseconds, rounded
+		// up to whole milliseconds
+		void wakeUp(qint64 usecs)
+		{
+			m_timer.start(int((usecs + 999) / 1000));
+		}
+
+		QSharedPointer<QMPFrameQueue> m_queue;
+		QTimer m_timer;
+		qint64 m_refreshInterval; // us
+
+		bool m_synced;
+		qint64 m_offset; // us
+		qint64 m_presentTime; // us
+		bool m_paintPending;
+
+		quint64 m_presented;
+		quint64 m_skipped;
+		quint64 m_late;
+		QMPLatencyHistogram m_upload;
+		QMPLatencyHistogram m_paint;
+};
+
+
+#endif // QMPFRAMEQUEUE_H_
@@ -0,0 +1,379 @@
+/*
+ *  qmpwidget - A Qt widget for embedding MPlayer
+ *  Copyright (C) 2010 by Jonas Gehring
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef QMPOPENGLWIDGET_H_
+#define QMPOPENGLWIDGET_H_
+
+
+#include <QGLBuffer>
+#include <QGLShaderProgram>
+#include <QGLWidget>
+#include <QImage>
+#ifndef GL_CLAMP_TO_EDGE
+ #define GL_CLAMP_TO_EDGE 0x812F
+#endif
+#ifndef GL_BGRA
+ #define GL_BGRA 0x80E1
+#endif
+#ifndef GL_UNSIGNED_INT_8_8_8_8_REV
+ #define GL_UNSIGNED_INT_8_8_8_8_REV 0x8367
+#endif
+
+#include "qmptrace.h"
+
+#ifdef QMP_USE_YUVPIPE
+ #include "qmpframequeue.h"
+ #include "qmpstatistics.h"
+#endif // QMP_USE_YUVPIPE
+
+
+// A OpenGL video widget
+class QMPOpenGLVideoWidget : public QGLWidget
+{
+	Q_OBJECT
+
+	public:
+		QMPOpenGLVideoWidget(QWidget *parent = 0)
+			: QGLWidget(parent), m_tex(-1)
+#ifdef QMP_USE_YUVPIPE
+			  , m_yuvProgram(NULL), m_yuvFailed(false), m_yuvFrame(false),
+			  m_rgbTex(0), m_rgbFrame(false), m_pboSupported(-1), m_pboIndex(0)
+#endif
+		{
+			setMouseTracking(true);
+#ifdef QMP_USE_YUVPIPE
+			m_scheduler = new QMPFrameScheduler(this);
+			connect(m_scheduler, SIGNAL(present()), this, SLOT(displayFrame()));
+#endif
+		}
+
+#ifdef QMP_USE_YUVPIPE
+		~QMPOpenGLVideoWidget()
+		{
+			makeCurrent();
+			if (m_yuvProgram != NULL) {
+				glDeleteTextures(3, m_yuvTex);
+			}
+			if (m_rgbTex != 0) {
+				glDeleteTextures(1, &m_rgbTex);
+			}
+			for (int i = 0; i < 2; i++) {
+				m_pbo[i].destroy();
+			}
+		}
+#endif
+
+		void showUserImage(const QImage &image)
+		{
+			m_userImage = image;
+
+			makeCurrent();
+			if (m_tex >= 0) {
+				deleteTexture(m_tex);
+			}
+			if (!m_userImage.isNull()) {
+				m_tex = bindTexture(image);
+				glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+				glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			} else {
+				glViewport(0, 0, width(), qMax(height(), 1));
+			}
+			updateGL();
+		}
+
+#ifdef QMP_USE_YUVPIPE
+		// Sets the queue that frames will be taken from in pipe mode
+		void setFrameQueue(const QSharedPointer<QMPFrameQueue> &queue)
+		{
+			if (queue == m_queue) {
+				return;
+			}
+			m_queue = queue;
+			if (m_queue) {
+				// Let the reader skip the color conversion if it can be done
+				// on the GPU
+				m_queue->setFormat(initYuvProgram() ? QMPFrame::YuvFormat : QMPFrame::RgbFormat);
+			}
+			m_scheduler->setQueue(m_queue);
+		}
+
+		QMPFrameScheduler *scheduler() const
+		{
+			return m_scheduler;
+		}
+
+	public slots:
+		// The frame buffer is given back to the reader as soon as it has
+		// been uploaded. Painting is scheduled like for other widgets, so
+		// the GUI thread doesn't wait for buffer swaps of multiple widgets
+		// in a row.
+		void displayFrame()
+		{
+			QMP_TRACE_SCOPE("displayFrame");
+			QMPFrame *frame = m_scheduler->take();
+			if (frame == NULL) {
+				return;
+			}
+			if (!m_userImage.isNull())  {
+				m_queue->release(frame);
+				m_scheduler->painted();
+				return;
+			}
+
+			qint64 start = qmpMicroseconds();
+			makeCurrent();
+			{
+				QMP_TRACE_SCOPE("uploadFrame");
+				if (frame->format == QMPFrame::YuvFormat) {
+					uploadYuvFrame(frame);
+				} else {
+					uploadRgbFrame(frame);
+				}
+				m_queue->release(frame);
+			}
+			m_scheduler->addUploadTime(qmpMicroseconds() - start);
+			update();
+		}
+
+	private:
+		// Compiles the shader program for converting YUV frames. Returns
+		// false if shader programs are not supported.
+		bool initYuvProgram()
+		{
+			if (m_yuvProgram != NULL) {
+				return true;
+			} else if (m_yuvFailed) {
+				return false;
+			}
+
+			makeCurrent();
+			m_yuvFailed = true;
+			if (!QGLShaderProgram::hasOpenGLShaderPrograms(context())) {
+				return false;
+			}
+
+			// Limited range BT.601 conversion, as done by QMPYuvConverter
+			static const char *source =
+				"uniform sampler2D ytex;\n"
+				"uniform sampler2D cbtex;\n"
+				"uniform sampler2D crtex;\n"
+				"void main()\n"
+				"{\n"
+				"	vec2 tc = gl_TexCoord[0].st;\n"
+				"	float y = (clamp(texture2D(ytex, tc).r, 16.0/255.0, 235.0/255.0) - 16.0/255.0) * (255.0/219.0);\n"
+				"	float cb = (clamp(texture2D(cbtex, tc).r, 16.0/255.0, 240.0/255.0) - 128.0/255.0) * (255.0/224.0);\n"
+				"	float cr = (clamp(texture2D(crtex, tc).r, 16.0/255.0, 240.0/255.0) - 128.0/255.0) * (255.0/224.0);\n"
+				"	vec3 rgb = vec3(y + 1.402 * cr, y - 0.344136 * cb - 0.714136 * cr, y + 1.772 * cb);\n"
+				"	gl_FragColor = vec4(clamp(rgb, 0.0, 1.0), 1.0);\n"
+				"}\n";
+
+			QGLShaderProgram *program = new QGLShaderProgram(context(), this);
+			if (!program->addShaderFromSourceCode(QGLShader::Fragment, source) || !program->link()) {
+				qWarning("Can't compile YUV shader: %s", qPrintable(program->log()));
+				delete program;
+				return false;
+			}
+
+			m_yuvProgram = program;
+			m_yuvFailed = false;
+			glGenTextures(3, m_yuvTex);
+			return true;
+		}
+
+		// Uploads the planes of a YUV frame into single-channel textures.
+		// The textures are only reallocated if the frame size changes.
+		void uploadYuvFrame(QMPFrame *frame)
+		{
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+			for (int i = 0; i < 3; i++) {
+				QSize size = (i == 0 ? QSize(frame->width, frame->height) : QSize(frame->cwidth, frame->cheight));
+				glBindTexture(GL_TEXTURE_2D, m_yuvTex[i]);
+				if (m_yuvSize[i] != size) {
+					glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE, size.width(), size.height(), 0, GL_LUMINANCE, GL_UNSIGNED_BYTE, NULL);
+					glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+					glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+					glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+					glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+					m_yuvSize[i] = size;
+				}
+				glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, size.width(), size.height(), GL_LUMINANCE, GL_UNSIGNED_BYTE, frame->plane(i));
+			}
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+			m_yuvFrame = true;
+			m_rgbFrame = false;
+		}
+
+		// Uploads an RGB frame into a persistent texture, which is only
+		// reallocated if the frame size changes. If pixel buffer objects are
+		// available, the frame is copied into one of two alternating buffers
+		// and the texture upload happens asynchronously.
+		void uploadRgbFrame(QMPFrame *frame)
+		{
+			const QImage &image = frame->image;
+			const int bytes = image.byteCount();
+			if (m_pboSupported < 0) {
+				QByteArray extensions((const char *)glGetString(GL_EXTENSIONS));
+				m_pboSupported = ((QGLFormat::openGLVersionFlags() & QGLFormat::OpenGL_Version_2_1)
+					|| extensions.contains("GL_ARB_pixel_buffer_object"));
+				for (int i = 0; i < 2 && m_pboSupported; i++) {
+					m_pbo[i] = QGLBuffer(QGLBuffer::PixelUnpackBuffer);
+					m_pbo[i].setUsagePattern(QGLBuffer::StreamDraw);
+					m_pboSupported = m_pbo[i].create();
+				}
+			}
+
+			if (m_rgbTex == 0) {
+				glGenTextures(1, &m_rgbTex);
+			}
+			glBindTexture(GL_TEXTURE_2D, m_rgbTex);
+			if (m_rgbSize != image.size()) {
+				glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image.width(), image.height(), 0, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, NULL);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+				m_rgbSize = image.size();
+			}
+
+			void *data = NULL;
+			if (m_pboSupported) {
+				// Re-allocating the buffer storage before mapping it avoids
+				// waiting for a transfer that is still in progress
+				m_pboIndex = 1 - m_pboIndex;
+				m_pbo[m_pboIndex].bind();
+				m_pbo[m_pboIndex].allocate(bytes);
+				data = m_pbo[m_pboIndex].map(QGLBuffer::WriteOnly);
+				if (data != NULL) {
+					memcpy(data, image.constBits(), bytes);
+					m_pbo[m_pboIndex].unmap();
+					glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, image.width(), image.height(), GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, 0);
+				}
+				m_pbo[m_pboIndex].release();
+			}
+			if (data == NULL) {
+				glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, image.width(), image.height(), GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, image.constBits());
+			}
+			m_rgbFrame = true;
+			m_yuvFrame = false;
+		}
+
+		// Draws a quad with the texture coordinates flipped vertically, for
+		// textures that have been uploaded top-down
+		void drawFlippedQuad()
+		{
+			glBegin(GL_QUADS);
+			glTexCoord2f(0, 1); glVertex2f(-1, -1);
+			glTexCoord2f(1, 1); glVertex2f( 1, -1);
+			glTexCoord2f(1, 0); glVertex2f( 1,  1);
+			glTexCoord2f(0, 0); glVertex2f(-1,  1);
+			glEnd();
+		}
+
+		// Draws the current YUV frame using the shader program
+		void paintYuvFrame()
+		{
+			m_yuvProgram->bind();
+			m_yuvProgram->setUniformValue("ytex", 0);
+			m_yuvProgram->setUniformValue("cbtex", 1);
+			m_yuvProgram->setUniformValue("crtex", 2);
+			for (int i = 2; i >= 0; i--) {
+				glActiveTexture(GL_TEXTURE0 + i);
+				glBindTexture(GL_TEXTURE_2D, m_yuvTex[i]);
+			}
+
+			drawFlippedQuad();
+			m_yuvProgram->release();
+		}
+#endif // QMP_USE_YUVPIPE
+
+	protected:
+		void initializeGL()
+		{
+			glEnable(GL_TEXTURE_2D);
+			glClearColor(0, 0, 0, 0);
+			glClearDepth(1);
+		}
+
+		void resizeGL(int w, int h)
+		{
+			glViewport(0, 0, w, qMax(h, 1));
+		}
+
+		void paintGL()
+		{
+			QMP_TRACE_SCOPE("paintGL");
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			glLoadIdentity();
+#ifdef QMP_USE_YUVPIPE
+			if ((m_yuvFrame || m_rgbFrame) && m_userImage.isNull()) {
+				const qint64 start = qmpMicroseconds();
+				if (m_yuvFrame) {
+					paintYuvFrame();
+				} else {
+					glBindTexture(GL_TEXTURE_2D, m_rgbTex);
+					drawFlippedQuad();
+				}
+				m_scheduler->addPaintTime(qmpMicroseconds() - start);
+				m_scheduler->painted();
+				return;
+			}
+			m_scheduler->painted();
+#endif
+			if (m_tex >= 0) {
+				glBindTexture(GL_TEXTURE_2D, m_tex);
+				if (!m_userImage.isNull()) {
+					QRect r = m_userImage.rect();
+					r.moveTopLeft(rect().center() - m_userImage.rect().center());
+					glViewport(r.x(), r.y(), r.width(), r.height());
+				}
+				glBegin(GL_QUADS);
+				glTexCoord2f(0, 0); glVertex2f(-1, -1);
+				glTexCoord2f(1, 0); glVertex2f( 1, -1);
+				glTexCoord2f(1, 1); glVertex2f( 1,  1);
+				glTexCoord2f(0, 1); glVertex2f(-1,  1);
+				glEnd();
+			}
+		}
+
+	private:
+		QImage m_userImage;
+		int m_tex;
+#ifdef QMP_USE_YUVPIPE
+		QSharedPointer<QMPFrameQueue> m_queue;
+		QMPFrameScheduler *m_scheduler;
+
+		// GPU-side color conversion
+		QGLShaderProgram *m_yuvProgram;
+		bool m_yuvFailed;
+		bool m_yuvFrame;
+		GLuint m_yuvTex[3];
+		QSize m_yuvSize[3];
+
+		// Streaming upload of RGB frames
+		GLuint m_rgbTex;
+		QSize m_rgbSize;
+		bool m_rgbFrame;
+		int m_pboSupported;
+		QGLBuffer m_pbo[2];
+		int m_pboIndex;
+#endif
+};
+
+
+#endif // QMPOPENGLWIDGET_H_
@@ -0,0 +1,188 @@
+/*
+ *  qmpwidget - A Qt widget for embedding MPlayer
+ *  Copyright (C) 2010 by Jonas Gehring
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef QMPOUTPUTPARSER_H_
+#define QMPOUTPUTPARSER_H_
+
+
+#include <cstring>
+
+#include "qmpwidget.h"
+
+
+// Internal scanners for MPlayer's output. These work on the raw bytes of a
+// line, without creating any intermediate strings, and don't depend on the
+// current locale.
+class QMPOutputParser
+{
+	public:
+		// Parses MPlayer's status line in a single pass. For videos, it looks like
+		// "A:   1.2 V:   1.2 A-V:  0.000 ct:  0.000  30/ 30  5%  2%  0.5% 0 0 50%",
+		// i.e. the labeled values are followed by the frame counters, CPU
+		// usage, dropped frames, postprocessing level and cache fill. Fields
+		// that are not printed (e.g. audio values for silent movies) are
+		// left unchanged.
+		static void scanStatus(const char *line, int len, QMPwidget::PlaybackStatus *status)
+		{
+			const char *p = line;
+			const char *end = line + len;
+
+			// Labeled values
+			while (true) {
+				while (p < end && *p == ' ') {
+					++p;
+				}
+				double *value;
+				if (hasPrefix(p, end, "A:")) {
+					value = &status->audioPosition;
+					p += 2;
+				} else if (hasPrefix(p, end, "V:")) {
+					value = &status->videoPosition;
+					p += 2;
+				} else if (hasPrefix(p, end, "A-V:")) {
+					value = &status->audioVideoDelay;
+					p += 4;
+				} else if (hasPrefix(p, end, "ct:")) {
+					value = &status->totalCorrection;
+					p += 3;
+				} else {
+					break;
+				}
+				if (!scanNumber(&p, end, value)) {
+					break;
+				}
+			}
+
+			// Unlabeled values. Audio-only status lines have a different
+			// format and will fail right at the start.
+			double frames;
+			if (scanNumber(&p, end, &frames) && p < end && *p == '/') {
+				status->playedFrames = (int)frames;
+				++p;
+				if (scanNumber(&p, end, &frames)) {
+					status->decodedFrames = (int)frames;
+					if (scanPercentage(&p, end, &status->videoCodecUsage)
+						&& scanPercentage(&p, end, &status->videoOutputUsage)
+						&& scanPercentage(&p, end, &status->audioCodecUsage)
+						&& scanNumber(&p, end, &frames)) {
+						status->droppedFrames = (int)frames;
+						if (scanNumber(&p, end, &frames)) {
+							status->postprocessingLevel = (int)frames;
+							double cache;
+							if (scanPercentage(&p, end, &cache)) {
+								status->cacheFill = (int)cache;
+							}
+						}
+					}
+				}
+			}
+		}
+
+		// Checks whether the given string starts with a prefix
+		static inline bool hasPrefix(const char *p, const char *end, const char *prefix)
+		{
+			while (*prefix != '\0') {
+				if (p == end || *p++ != *prefix++) {
+					return false;
+				}
+			}
+			return true;
+		}
+
+		// Scans a number, skipping leading whitespace. Returns false if there's
+		// no number at the current position.
+		static bool scanNumber(const char **p, const char *end, double *value)
+		{
+			const char *start = *p;
+			while (start < end && *start == ' ') {
+				++start;
+			}
+			const char *digits = start;
+			if (digits < end && (*digits == '-' || *digits == '+')) {
+				++digits;
+			}
+			if (digits == end || *digits < '0' || *digits > '9') {
+				return false;
+			}
+			*value = parseDouble(start, end, p);
+			return true;
+		}
+
+		// Scans a number followed by a percent sign
+		static bool scanPercentage(const char **p, const char *end, double *value)
+		{
+			if (!scanNumber(p, end, value) || *p == end || **p != '%') {
+				return false;
+			}
+			++(*p);
+			return true;
+		}
+
+		// Checks whether the key of an identification line matches
+		static inline bool isKey(const char *line, int len, const char *key)
+		{
+			return (len == (int)strlen(key) && memcmp(line, key, len) == 0);
+		}
+
+		// Parses the integer part of a decimal number
+		static int parseInt(const char *p, const char *end)
+		{
+			return (int)parseDouble(p, end);
+		}
+
+		// Parses a decimal number in fixed-point notation. This is independent
+		// of the current locale, in contrast to strtod(). If \p next is given,
+		// it will point to the first character after the number.
+		static double parseDouble(const char *p, const char *end, const char **next = NULL)
+		{
+			while (p < end && *p == ' ') {
+				++p;
+			}
+			bool negative = false;
+			if (p < end && (*p == '-' || *p == '+')) {
+				negative = (*p == '-');
+				++p;
+			}
+
+			double value = 0;
+			while (p < end && *p >= '0' && *p <= '9') {
+				value = value * 10 + (*p - '0');
+				++p;
+			}
+			if (p < end && *p == '.') {
+				++p;
+				double scale = 1;
+				double fraction = 0;
+				while (p < end && *p >= '0' && *p <= '9') {
+					fraction = fraction * 10 + (*p - '0');
+					scale *= 10;
+					++p;
+				}
+				value += fraction / scale;
+			}
+
+			if (next != NULL) {
+				*next = p;
+			}
+			return (negative ? -value : value);
+		}
+};
+
+
+#endif // QMPOUTPUTPARSER_H_
@@ -0,0 +1,148 @@
+/*
+ *  qmpwidget - A Qt widget for embedding MPlayer
+ *  Copyright (C) 2010 by Jonas Gehring
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef QMPSTATISTICS_H_
+#define QMPSTATISTICS_H_
+
+
+#include <QtGlobal>
+
+#include <cstring>
+#if defined(Q_WS_WIN)
+ #include "windows.h"
+#elif defined(Q_WS_MAC)
+ #include <mach/mach_time.h>
+#else
+ #include <time.h>
+#endif
+
+
+// Returns a monotonic timestamp in microseconds for measuring short
+// durations, which isn't affected by adjustments of the system clock. This is
+// used for statistics and trace events.
+static inline qint64 qmpMicroseconds()
+{
+#if defined(Q_WS_WIN)
+	static LARGE_INTEGER frequency = { { 0, 0 } };
+	if (frequency.QuadPart == 0) {
+		QueryPerformanceFrequency(&frequency);
+	}
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	return qint64(counter.QuadPart * 1000000.0 / frequency.QuadPart);
+#elif defined(Q_WS_MAC)
+	static mach_timebase_info_data_t timebase = { 0, 0 };
+	if (timebase.denom == 0) {
+		mach_timebase_info(&timebase);
+	}
+	return qint64(mach_absolute_time() * timebase.numer / timebase.denom / 1000);
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return qint64(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
+
+
+// Internal latency histogram with logarithmic buckets. Bucket i counts
+// durations in [2^i - 1, 2^(i+1) - 1) microseconds, so adding a sample is
+// just a few integer operations, and the histogram can be copied cheaply.
+// Percentiles are interpolated linearly within a bucket.
+class QMPLatencyHistogram
+{
+	public:
+		QMPLatencyHistogram()
+		{
+			reset();
+		}
+
+		void reset()
+		{
+			memset(m_buckets, 0, sizeof(m_buckets));
+			m_count = 0;
+		}
+
+		// Adds a duration in microseconds
+		void add(qint64 usecs)
+		{
+			quint64 v = quint64(qMax(usecs, qint64(0))) + 1;
+			int i = 0;
+			while (v > 1 && i < NumBuckets - 1) {
+				v >>= 1;
+				++i;
+			}
+			++m_buckets[i];
+			++m_count;
+		}
+
+		quint64 count() const
+		{
+			return m_count;
+		}
+
+		// Returns the approximate duration in microseconds below which the
+		// given fraction of the samples lies, or 0 if there are no samples
+		double percentile(double fraction) const
+		{
+			if (m_count == 0) {
+				return 0;
+			}
+
+			const double target = qBound(0.0, fraction, 1.0) * m_count;
+			quint64 below = 0;
+			for (int i = 0; i < NumBuckets; i++) {
+				if (m_buckets[i] > 0 && below + m_buckets[i] >= target) {
+					double lower = double((quint64(1) << i) - 1);
+					double upper = double((quint64(1) << (i + 1)) - 1);
+					return lower + (upper - lower) * (target - below) / m_buckets[i];
+				}
+				below += m_buckets[i];
+			}
+			return double((quint64(1) << NumBuckets) - 1);
+		}
+
+	private:
+		enum {
+			NumBuckets = 32
+		};
+
+		quint32 m_buckets[NumBuckets];
+		quint64 m_count;
+};
+
+
+// Counters of the YUV reader thread
+class QMPReaderStatistics
+{
+	public:
+		QMPReaderStatistics()
+			: framesRead(0), framesConverted(0), readCalls(0)
+		{
+
+		}
+
+		quint64 framesRead;
+		quint64 framesConverted;
+		quint64 readCalls;
+		QMPLatencyHistogram read;
+		QMPLatencyHistogram convert;
+};
+
+
+#endif // QMPSTATISTICS_H_
@@ -0,0 +1,306 @@
+/*
+ *  qmpwidget - A Qt widget for embedding MPlayer
+ *  Copyright (C) 2010 by Jonas Gehring
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef QMPTRACE_H_
+#define QMPTRACE_H_
+
+
+// Trace points are compiled in only if QMP_USE_TRACING is defined, which is
+// done by adding "tracing" to the QMake configuration. Otherwise, the macros
+// expand to nothing.
+#ifdef QMP_USE_TRACING
+
+#include <QAtomicInt>
+#include <QCoreApplication>
+#include <QFile>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QThreadStorage>
+
+#include "qmpstatistics.h"
+
+
+// A single trace event. Instant events have a negative duration.
+struct QMPTraceEvent
+{
+	const char *name;
+	qint64 time;
+	qint64 duration;
+	int value;
+	int thread;
+};
+
+
+// Ring buffer of trace events of a single thread. Only the owning thread
+// writes to the buffer, so recording an event doesn't need any locking. The
+// write position is an unsigned sequence number that is published atomically
+// and may wrap around. Readers check the position again after copying and
+// discard events that might have been overwritten in the meantime.
+class QMPTraceBuffer
+{
+	public:
+		enum {
+			Capacity = 16384 // Needs to be a power of two
+		};
+
+		QMPTraceBuffer()
+			: m_head(0), m_full(false)
+		{
+
+		}
+
+		void record(const char *name, qint64 time, qint64 duration, int value, int thread)
+		{
+			uint head = uint(int(m_head));
+			QMPTraceEvent &e = m_events[head & (Capacity - 1)];
+			e.name = name;
+			e.time = time;
+			e.duration = duration;
+			e.value = value;
+			e.thread = thread;
+			++head;
+			if (head == uint(Capacity)) {
+				m_full = true;
+			}
+			m_head.fetchAndStoreRelease(int(head));
+		}
+
+		// Appends the recorded events to \p events
+		void collect(QList<QMPTraceEvent> *events) const
+		{
+			uint head = this->head();
+			uint count = ((m_full || head >= uint(Capacity)) ? uint(Capacity) : head);
+			uint first = head - count;
+			int start = events->count();
+			for (uint i = 0; i < count; i++) {
+				events->append(m_events[(first + i) & (Capacity - 1)]);
+			}
+
+			// The writer may have overwritten the oldest slots while they were
+			// copied, including the slot it is writing right now
+			uint written = this->head() - first;
+			if (written >= uint(Capacity)) {
+				uint overwritten = qMin(written - uint(Capacity) + 1, count);
+				QList<QMPTraceEvent>::iterator begin = events->begin() + start;
+				events->erase(begin, begin + overwritten);
+			}
+		}
+
+	private:
+		uint head() const
+		{
+			return uint(const_cast<QAtomicInt &>(m_head).fetchAndAddAcquire(0));
+		}
+
+		QAtomicInt m_head;
+		bool m_full;
+		QMPTraceEvent m_events[Capacity];
+};
+
+
+// Internal process-wide trace recorder. Every thread records into its own
+// buffer, which is created on the first event of the thread. Buffers of
+// finished threads are kept (including their events) and reused by new
+// threads.
+class QMPTrace
+{
+	public:
+		// Records a complete event
+		static void record(const char *name, qint64 start, qint64 end)
+		{
+			Thread *t = thread();
+			t->buffer->record(name, start - instance()->m_epoch, end - start, 0, t->id);
+		}
+
+		// Records an instant event with an integer argument
+		static void instant(const char *name, int value)
+		{
+			Thread *t = thread();
+			t->buffer->record(name, now() - instance()->m_epoch, -1, value, t->id);
+		}
+
+		// Sets the name of the current thread, as shown by trace viewers
+		static void setThreadName(const char *name)
+		{
+			QMPTrace *trace = instance();
+			int id = thread()->id;
+			QMutexLocker locker(&trace->m_mutex);
+			trace->m_names.insert(id, QByteArray(name));
+		}
+
+		// Returns a monotonic timestamp in microseconds
+		static qint64 now()
+		{
+			return qmpMicroseconds();
+		}
+
+		// Writes all recorded events to a file in the Chrome trace event
+		// format, which can be loaded by chrome://tracing and Perfetto
+		static bool save(const QString &fileName)
+		{
+			QFile file(fileName);
+			if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+				return false;
+			}
+
+			QMPTrace *trace = instance();
+			QList<QMPTraceEvent> events;
+			QHash<int, QByteArray> names;
+			trace->m_mutex.lock();
+			for (int i = 0; i < trace->m_buffers.count(); i++) {
+				trace->m_buffers[i]->collect(&events);
+			}
+			names = trace->m_names;
+			trace->m_mutex.unlock();
+
+			const QByteArray pid = QByteArray::number(QCoreApplication::applicationPid());
+			QByteArray out("{\"traceEvents\":[\n");
+			QHash<int, QByteArray>::const_iterator it;
+			for (it = names.constBegin(); it != names.constEnd(); ++it) {
+				out += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" + pid + ",\"tid\":" + QByteArray::number(it.key());
+				out += ",\"args\":{\"name\":\"" + escape(it.value()) + "\"}},\n";
+			}
+			for (int i = 0; i < events.count(); i++) {
+				const QMPTraceEvent &e = events[i];
+				out += "{\"name\":\"" + escape(e.name) + "\",\"cat\":\"qmpwidget\",\"pid\":" + pid + ",\"tid\":" + QByteArray::number(e.thread);
+				out += ",\"ts\":" + QByteArray::number(e.time);
+				if (e.duration >= 0) {
+					out += ",\"ph\":\"X\",\"dur\":" + QByteArray::number(e.duration) + "},\n";
+				} else {
+					out += ",\"ph\":\"i\",\"s\":\"t\",\"args\":{\"value\":" + QByteArray::number(e.value) + "}},\n";
+				}
+			}
+			if (out.endsWith(",\n")) {
+				out.chop(2);
+			}
+			out += "\n],\"displayTimeUnit\":\"ms\"}\n";
+			return (file.write(out) == out.size());
+		}
+
+	private:
+		// Per-thread state, deleted by QThreadStorage when the thread exits
+		class Thread
+		{
+			public:
+				Thread(int id, QMPTraceBuffer *buffer)
+					: id(id), buffer(buffer)
+				{
+
+				}
+
+				~Thread()
+				{
+					QMPTrace *trace = instance();
+					QMutexLocker locker(&trace->m_mutex);
+					trace->m_free.append(buffer);
+				}
+
+				int id;
+				QMPTraceBuffer *buffer;
+		};
+
+		QMPTrace()
+			: m_epoch(now()), m_lastThread(0)
+		{
+
+		}
+
+		// The instance is never deleted, since threads may exit after
+		// static destruction
+		static QMPTrace *instance()
+		{
+			static QMPTrace *trace = new QMPTrace();
+			return trace;
+		}
+
+		static Thread *thread()
+		{
+			QMPTrace *trace = instance();
+			if (!trace->m_threads.hasLocalData()) {
+				QMutexLocker locker(&trace->m_mutex);
+				QMPTraceBuffer *buffer;
+				if (!trace->m_free.isEmpty()) {
+					buffer = trace->m_free.takeLast();
+				} else {
+					buffer = new QMPTraceBuffer();
+					trace->m_buffers.append(buffer);
+				}
+				trace->m_threads.setLocalData(new Thread(++trace->m_lastThread, buffer));
+			}
+			return trace->m_threads.localData();
+		}
+
+		static QByteArray escape(const QByteArray &s)
+		{
+			QByteArray e(s);
+			e.replace('\\', "\\\\");
+			e.replace('"', "\\\"");
+			return e;
+		}
+
+	private:
+		qint64 m_epoch;
+		QMutex m_mutex;
+		QThreadStorage<Thread *> m_threads;
+		QList<QMPTraceBuffer *> m_buffers;
+		QList<QMPTraceBuffer *> m_free;
+		QHash<int, QByteArray> m_names;
+		int m_lastThread;
+};
+
+
+// Records the lifetime of a scope as a trace event
+class QMPTraceScope
+{
+	public:
+		QMPTraceScope(const char *name)
+			: m_name(name), m_start(QMPTrace::now())
+		{
+
+		}
+
+		~QMPTraceScope()
+		{
+			QMPTrace::record(m_name, m_start, QMPTrace::now());
+		}
+
+	private:
+		const char *m_name;
+		qint64 m_start;
+};
+
+
+// Trace point names need to be string literals
+#define QMP_TRACE_CONCAT_(a, b) a##b
+#define QMP_TRACE_CONCAT(a, b) QMP_TRACE_CONCAT_(a, b)
+#define QMP_TRACE_SCOPE(name) QMPTraceScope QMP_TRACE_CONCAT(qmpTraceScope, __LINE__)(name)
+#define QMP_TRACE_EVENT(name, value) QMPTrace::instant(name, value)
+#define QMP_TRACE_THREAD(name) QMPTrace::setThreadName(name)
+
+#else // QMP_USE_TRACING
+
+#define QMP_TRACE_SCOPE(name)
+#define QMP_TRACE_EVENT(name, value)
+#define QMP_TRACE_THREAD(name)
+
+#endif // QMP_USE_TRACING
+
+
+#endif // QMPTRACE_H_
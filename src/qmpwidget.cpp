@@ -18,6 +18,7 @@
 
 
 #include <QAbstractSlider>
+#include <QCoreApplication>
 #include <QKeyEvent>
 #include <QLocalSocket>
 #include <QPainter>
@@ -25,13 +26,17 @@
 #include <QStringList>
 #include <QTemporaryFile>
 #include <QThread>
+#include <QVarLengthArray>
 #include <QtDebug>
 
+#include "qmpwidget.h"
+#include "qmpcapabilities.h"
 #ifdef QT_OPENGL_LIB
- #include <QGLWidget>
+ #include "qmpopenglwidget.h"
 #endif
-
-#include "qmpwidget.h"
+#include "qmpoutputparser.h"
+#include "qmpstatistics.h"
+#include "qmptrace.h"
 
 //#define QMP_DEBUG_OUTPUT
 
@@ -48,10 +53,50 @@ class QMPPlainVideoWidget : public QWidget
 	public:
 		QMPPlainVideoWidget(QWidget *parent = 0)
 			: QWidget(parent)
+#ifdef QMP_USE_YUVPIPE
+			  , m_frame(NULL)
+#endif
 		{
 			setAttribute(Qt::WA_NoSystemBackground);
 			setMouseTracking(true);
+#ifdef QMP_USE_YUVPIPE
+			m_scheduler = new QMPFrameScheduler(this);
+			connect(m_scheduler, SIGNAL(present()), this, SLOT(displayFrame()));
+#endif
+		}
+
+#ifdef QMP_USE_YUVPIPE
+		~QMPPlainVideoWidget()
+		{
+			setFrameQueue(QSharedPointer<QMPFrameQueue>());
+		}
+
+		// Sets the queue that frames will be taken from in pipe mode
+		void setFrameQueue(const QSharedPointer<QMPFrameQueue> &queue)
+		{
+			if (queue == m_queue) {
+				return;
+			}
+			if (m_queue) {
+				disconnect(m_queue.data(), 0, this, 0);
+				if (m_frame != NULL) {
+					m_queue->release(m_frame);
+					m_frame = NULL;
+				}
+			}
+			m_queue = queue;
+			if (m_queue) {
+				// Frames will be scaled to the widget size by the reader
+				m_queue->setTargetSize(size());
+			}
+			m_scheduler->setQueue(m_queue);
+		}
+
+		QMPFrameScheduler *scheduler() const
+		{
+			return m_scheduler;
 		}
+#endif // QMP_USE_YUVPIPE
 
 		void showUserImage(const QImage &image)
 		{
@@ -59,136 +104,93 @@ class QMPPlainVideoWidget : public QWidget
 			update();
 		}
 
+#ifdef QMP_USE_YUVPIPE
 	public slots:
-		void displayImage(const QImage &image)
+		// The frame buffer is kept until the next frame arrives and will be
+		// painted directly, without any intermediate copies
+		void displayFrame()
 		{
-			m_pixmap = QPixmap::fromImage(image);
+			QMP_TRACE_SCOPE("displayFrame");
+			QMPFrame *frame = m_scheduler->take();
+			if (frame == NULL) {
+				return;
+			}
+			if (m_frame != NULL) {
+				m_queue->release(m_frame);
+			}
+			m_frame = frame;
 			update();
 		}
+#endif // QMP_USE_YUVPIPE
 
 	protected:
 		void paintEvent(QPaintEvent *event)
 		{
 			Q_UNUSED(event);
+			QMP_TRACE_SCOPE("paintEvent");
+#ifdef QMP_USE_YUVPIPE
+			const qint64 start = qmpMicroseconds();
+#endif
 			QPainter p(this);
 			p.setCompositionMode(QPainter::CompositionMode_Source);
 
 			if (!m_userImage.isNull()) {
 				p.fillRect(rect(), Qt::black);
 				p.drawImage(rect().center() - m_userImage.rect().center(), m_userImage);
-			} else if (!m_pixmap.isNull()) {
-				p.drawPixmap(rect(), m_pixmap);
+#ifdef QMP_USE_YUVPIPE
+			} else if (m_frame != NULL) {
+				// Frames that have been read before a resize need to be scaled
+				if (m_frame->image.size() == size()) {
+					p.drawImage(0, 0, m_frame->image);
+				} else {
+					p.drawImage(rect(), m_frame->image);
+				}
+#endif
 			} else {
 				p.fillRect(rect(), Qt::black);
 			}
 			p.end();
-		}
-
-	private:
-		QPixmap m_pixmap;
-		QImage m_userImage;
-};
-
-
-#ifdef QT_OPENGL_LIB
-
-// A OpenGL video widget
-class QMPOpenGLVideoWidget : public QGLWidget
-{
-	Q_OBJECT
-
-	public:
-		QMPOpenGLVideoWidget(QWidget *parent = 0)
-			: QGLWidget(parent), m_tex(-1)
-		{
-			setMouseTracking(true);
-		}
-
-		void showUserImage(const QImage &image)
-		{
-			m_userImage = image;
-
-			makeCurrent();
-			if (m_tex >= 0) {
-				deleteTexture(m_tex);
-			}
-			if (!m_userImage.isNull()) {
-				m_tex = bindTexture(image);
-				glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-				glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-			} else {
-				glViewport(0, 0, width(), qMax(height(), 1));
-			}
-			updateGL();
-		}
-
-	public slots:
-		void displayImage(const QImage &image)
-		{
-			if (!m_userImage.isNull())  {
-				return;
-			}
 
-			makeCurrent();
-			if (m_tex >= 0) {
-				deleteTexture(m_tex);
+#ifdef QMP_USE_YUVPIPE
+			if (m_userImage.isNull() && m_frame != NULL) {
+				m_scheduler->addPaintTime(qmpMicroseconds() - start);
 			}
-			m_tex = bindTexture(image);
-			glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-			glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-			updateGL();
-		}
-
-	protected:
-		void initializeGL()
-		{
-			glEnable(GL_TEXTURE_2D);
-			glClearColor(0, 0, 0, 0);
-			glClearDepth(1);
-		}
-
-		void resizeGL(int w, int h)
-		{
-			glViewport(0, 0, w, qMax(h, 1));
+			m_scheduler->painted();
+#endif
 		}
 
-		void paintGL()
+#ifdef QMP_USE_YUVPIPE
+		void resizeEvent(QResizeEvent *event)
 		{
-			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-			glLoadIdentity();
-			if (m_tex >= 0) {
-				glBindTexture(GL_TEXTURE_2D, m_tex);
-				if (!m_userImage.isNull()) {
-					QRect r = m_userImage.rect();
-					r.moveTopLeft(rect().center() - m_userImage.rect().center());
-					glViewport(r.x(), r.y(), r.width(), r.height());
-				}
-				glBegin(GL_QUADS);
-				glTexCoord2f(0, 0); glVertex2f(-1, -1);
-				glTexCoord2f(1, 0); glVertex2f( 1, -1);
-				glTexCoord2f(1, 1); glVertex2f( 1,  1);
-				glTexCoord2f(0, 1); glVertex2f(-1,  1);
-				glEnd();
+			if (m_queue) {
+				m_queue->setTargetSize(event->size());
 			}
+			QWidget::resizeEvent(event);
 		}
+#endif
 
 	private:
 		QImage m_userImage;
-		int m_tex;
+#ifdef QMP_USE_YUVPIPE
+		QSharedPointer<QMPFrameQueue> m_queue;
+		QMPFrameScheduler *m_scheduler;
+		QMPFrame *m_frame;
+#endif
 };
 
-#endif // QT_OPENGL_LIB
-
 
 // A custom QProcess designed for the MPlayer slave interface
-class QMPProcess : public QProcess
+class QMPProcess : public QProcess, private QMPOutputParser
 {
 	Q_OBJECT
 
 	public:
 		QMPProcess(QObject *parent = 0)
 			: QProcess(parent), m_state(QMPwidget::NotStartedState), m_mplayerPath("mplayer"),
-			  m_fakeInputconf(NULL)
+			  m_conversionThreads(1), m_scalingMode(Qt::SmoothTransformation), m_frameQueueSize(1), m_frameDropPolicy(QMPwidget::DropOldestFrame),
+			  m_pipeBufferSize(1048576), m_linesParsed(0), m_bytesParsed(0), m_emitStdout(false), m_emitStderr(false),
+			  m_emitStatus(false), m_startPending(false), m_probeRequested(false), m_queriesOffset(0), m_queuedCommands(0), m_flushPending(false),
+			  m_commandsWritten(0), m_bytesWritten(0), m_deleteWhenFinished(false), m_fakeInputconf(NULL)
 #ifdef QMP_USE_YUVPIPE
 			  , m_yuvReader(NULL)
 #endif
@@ -216,15 +218,25 @@ class QMPProcess : public QProcess
 
 			m_movieFinishedTimer.setSingleShot(true);
 			m_movieFinishedTimer.setInterval(100);
+			m_killTimer.setSingleShot(true);
+			m_killTimer.setInterval(1000);
 
 			connect(this, SIGNAL(readyReadStandardOutput()), this, SLOT(readStdout()));
 			connect(this, SIGNAL(readyReadStandardError()), this, SLOT(readStderr()));
+			connect(this, SIGNAL(started()), this, SLOT(processStarted()));
 			connect(this, SIGNAL(finished(int, QProcess::ExitStatus)), this, SLOT(finished()));
+			connect(this, SIGNAL(error(QProcess::ProcessError)), this, SLOT(processError(QProcess::ProcessError)));
 			connect(&m_movieFinishedTimer, SIGNAL(timeout()), this, SLOT(movieFinished()));
+			connect(&m_killTimer, SIGNAL(timeout()), this, SLOT(kill()));
+			connect(QMPCapabilityCache::instance(), SIGNAL(probed(const QString &)), this, SLOT(tryStart()));
 		}
 
 		~QMPProcess()
 		{
+			// The reader finishes and deletes itself in the background
+			if (QProcess::state() != QProcess::NotRunning) {
+				QProcess::kill();
+			}
 #ifdef QMP_USE_YUVPIPE
 			if (m_yuvReader != NULL) {
 				m_yuvReader->stop();
@@ -235,30 +247,51 @@ class QMPProcess : public QProcess
 			}
 		}
 
-		// Starts the MPlayer process in idle mode
+		// Requests starting the MPlayer process in idle mode. The process is
+		// started as soon as a previous process has quit and the capabilities
+		// of the executable are known, i.e. this function never blocks.
+		// Commands written in the meantime will be buffered.
 		void start(QWidget *widget, const QStringList &args)
+		{
+			m_startPending = true;
+			m_probeRequested = false;
+			m_startWidget = widget;
+			m_startArgs = args;
+			clearCommands();
+			m_queries.clear();
+
+			if (QProcess::state() != QProcess::NotRunning) {
+				requestQuit();
+			}
+			tryStart();
+		}
+
+		// Returns whether the process has been requested to start, but isn't
+		// running yet
+		bool isStarting() const
+		{
+			return (m_startPending || QProcess::state() == QProcess::Starting);
+		}
+
+	private:
+		// Actually starts the MPlayer process
+		void launch(QWidget *widget, const QStringList &args, const QMPCapabilities &caps)
 		{
 			if (m_mode == QMPwidget::PipeMode) {
 #ifdef QMP_USE_YUVPIPE
-				m_yuvReader = new QMPYuvReader(this);
+				m_frameQueue = QSharedPointer<QMPFrameQueue>(new QMPFrameQueue(m_frameQueueSize, m_frameDropPolicy));
+				m_yuvReader = new QMPYuvReader(m_frameQueue, this);
+				connect(m_yuvReader, SIGNAL(endOfStream()), this, SLOT(streamEnded()));
+				m_yuvReader->setThreadCount(m_conversionThreads);
+				m_yuvReader->setScalingMode(m_scalingMode);
+				m_yuvReader->setBufferSize(m_pipeBufferSize);
 #else
 				m_mode = QMPwidget::EmbeddedMode;
 #endif
 			}
 
-			// Figure out the mplayer version in order to check if 
-			// "-input nodefault-bindings" is available
-			bool useFakeInputconf = true;
-			QString version = mplayerVersion();
-			if (version.contains("SVN")) { // Check revision
-				QRegExp re("SVN-r([0-9]*)");
-				if (re.indexIn(version) > -1) {
-					int revision = re.cap(1).toInt();
-					if (revision >= 28878) {
-						useFakeInputconf = false;
-					}
-				}
-			}
+			// Check if "-input nodefault-bindings" is available
+			bool useFakeInputconf = !caps.nodefaultBindings;
 
 			QStringList myargs;
 			myargs += "-slave";
@@ -278,7 +311,7 @@ class QMPProcess : public QProcess
 				if (m_fakeInputconf == NULL) {
 					m_fakeInputconf = new QTemporaryFile();
 					if (m_fakeInputconf->open()) {
-						writeFakeInputconf(m_fakeInputconf);
+						writeFakeInputconf(m_fakeInputconf, caps.keys);
 					} else {
 						delete m_fakeInputconf;
 						m_fakeInputconf = NULL;
@@ -309,34 +342,46 @@ class QMPProcess : public QProcess
 #ifdef QMP_DEBUG_OUTPUT
 			qDebug() << myargs;
 #endif
+			// The state changes to QMPwidget::IdleState once the process has
+			// been started
 			QProcess::start(m_mplayerPath, myargs);
-			changeState(QMPwidget::IdleState);
 
 			if (m_mode == QMPwidget::PipeMode) {
 #ifdef QMP_USE_YUVPIPE
-				connect(m_yuvReader, SIGNAL(imageReady(const QImage &)), widget, SLOT(displayImage(const QImage &)));
 				m_yuvReader->start();
 #endif
 			}
 		}
 
-		QString mplayerVersion()
+	public:
+
+		// Copies the widget-related settings of another process, e.g. when
+		// taking over a process from the pool. Settings that only apply when
+		// starting a process (like the pipe buffer size) take effect on the
+		// next start.
+		void copySettings(const QMPProcess *other)
 		{
-			QProcess p;
-			p.start(m_mplayerPath, QStringList("-version"));
-			if (!p.waitForStarted()) {
-				return QString();
+			m_videoOutput = other->m_videoOutput;
+			m_pipeBufferSize = other->m_pipeBufferSize;
+			m_conversionThreads = other->m_conversionThreads;
+			m_scalingMode = other->m_scalingMode;
+			m_frameQueueSize = other->m_frameQueueSize;
+			m_frameDropPolicy = other->m_frameDropPolicy;
+#ifdef QMP_USE_YUVPIPE
+			if (m_yuvReader != NULL) {
+				m_yuvReader->setThreadCount(m_conversionThreads);
+				m_yuvReader->setScalingMode(m_scalingMode);
 			}
-			if (!p.waitForFinished()) {
-				return QString();
+			if (m_frameQueue) {
+				m_frameQueue->setSize(m_frameQueueSize);
+				m_frameQueue->setPolicy(m_frameDropPolicy);
 			}
+#endif
+		}
 
-			QString output = QString(p.readAll());
-			QRegExp re("MPlayer ([^ ]*)");
-			if (re.indexIn(output) > -1) {
-				return re.cap(1);
-			}
-			return output;
+		QString mplayerVersion()
+		{
+			return QMPCapabilityCache::instance()->capabilities(m_mplayerPath, true).version;
 		}
 
 		QProcess::ProcessState processState() const
@@ -344,38 +389,112 @@ class QMPProcess : public QProcess
 			return QProcess::state();
 		}
 
-		void writeCommand(const QString &command)
+		// Queues a command for MPlayer. All commands are written at once
+		// when control returns to the event loop (or once the process has
+		// been started), in the order they have been queued. Priority
+		// commands only overtake pending property queries.
+		void writeCommand(const QString &command, bool priority = false)
 		{
+			QMP_TRACE_SCOPE("writeCommand");
 #ifdef QMP_DEBUG_OUTPUT
 			qDebug("in: \"%s\"", qPrintable(command));
 #endif
-			QProcess::write(command.toLocal8Bit()+"\n");
+			QByteArray line = command.toLocal8Bit();
+			line.append('\n');
+			if (priority) {
+				m_commands.insert(m_queriesOffset, line);
+				m_queriesOffset += line.size();
+			} else {
+				m_commands.append(line);
+				m_queriesOffset = m_commands.size();
+			}
+			commandQueued();
 		}
 
+		// Asks MPlayer to quit, without blocking. The process will be killed
+		// if it doesn't quit in time.
 		void quit()
 		{
-			writeCommand("quit");
-			QProcess::waitForFinished(100);
-			if (QProcess::state() == QProcess::Running) {
-				QProcess::kill();
-			}
-			QProcess::waitForFinished(-1);
+			m_startPending = false;
+			clearCommands();
+			m_queries.clear();
+			requestQuit();
+		}
+
+		// Lets the process quit in the background and deletes it afterwards.
+		// This is used if the widget is deleted while MPlayer is running, so
+		// the process needs a new parent until then.
+		void quitAndDelete()
+		{
+			setParent(QCoreApplication::instance());
+			m_deleteWhenFinished = true;
+			quit();
 		}
 
 		void pause()
 		{
-			writeCommand("pause");
+			writeCommand("pause", true);
 		}
 
 		void stop()
 		{
-			writeCommand("stop");
+			writeCommand("stop", true);
+		}
+
+		// Asks MPlayer for the value of a property, without changing the
+		// pause state unless \p keepPause is false. The answer will be
+		// reported by propertyReceived() or propertyError() with the given id.
+		void queryProperty(int id, const QString &name, bool keepPause = true)
+		{
+			PropertyQuery query;
+			query.id = id;
+			query.name = name.toLatin1();
+			query.time.start();
+			m_queries.append(query);
+
+			// Queries are appended without moving the queries offset
+#ifdef QMP_DEBUG_OUTPUT
+			qDebug("in: \"get_property %s\"", query.name.constData());
+#endif
+			if (keepPause) {
+				m_commands.append("pausing_keep_force ");
+			}
+			m_commands.append("get_property ");
+			m_commands.append(query.name);
+			m_commands.append('\n');
+			commandQueued();
+		}
+
+		// Fails queries that haven't been answered within \p timeout
+		// milliseconds, e.g. because MPlayer dropped them while loading a
+		// file. Queries are answered in order, so only the oldest ones
+		// need to be checked.
+		void expireQueries(int timeout)
+		{
+			while (!m_queries.isEmpty() && m_queries.first().time.elapsed() > timeout) {
+				PropertyQuery query = m_queries.takeFirst();
+				emit propertyError(query.id, QString::fromLatin1(query.name));
+			}
+		}
+
+		// Returns whether there's an unanswered query with the given id
+		bool hasPendingQuery(int id) const
+		{
+			for (int i = 0; i < m_queries.count(); i++) {
+				if (m_queries[i].id == id) {
+					return true;
+				}
+			}
+			return false;
 		}
 
 	signals:
 		void stateChanged(int state);
 		void streamPositionChanged(double position);
+		void playbackStatusChanged(const QMPwidget::PlaybackStatus &status);
 		void error(const QString &reason);
+		void propertyReceived(int id, const QString &name, const QString &value);
+		void propertyError(int id, const QString &name);
 
 		void readStandardOutput(const QString &line);
 		void readStandardError(const QString &line);
@@ -383,34 +502,95 @@ class QMPProcess : public QProcess
 	private slots:
 		void readStdout()
 		{
-			QStringList lines = QString::fromLocal8Bit(readAllStandardOutput()).split("\n", QString::SkipEmptyParts);
-			for (int i = 0; i < lines.count(); i++) {
-				lines[i].remove("\r");
-#ifdef QMP_DEBUG_OUTPUT
-				qDebug("out: \"%s\"", qPrintable(lines[i]));
-#endif
-				parseLine(lines[i]);
-				emit readStandardOutput(lines[i]);
-			}
+			QMP_TRACE_SCOPE("readStdout");
+			readLines(QProcess::StandardOutput, &m_stdoutLine);
 		}
 
 		void readStderr()
 		{
-			QStringList lines = QString::fromLocal8Bit(readAllStandardError()).split("\n", QString::SkipEmptyParts);
-			for (int i = 0; i < lines.count(); i++) {
-				lines[i].remove("\r");
-#ifdef QMP_DEBUG_OUTPUT
-				qDebug("err: \"%s\"", qPrintable(lines[i]));
-#endif
-				parseLine(lines[i]);
-				emit readStandardError(lines[i]);
+			QMP_TRACE_SCOPE("readStderr");
+			readLines(QProcess::StandardError, &m_stderrLine);
+		}
+
+		// Starts the process if a start has been requested and the
+		// executable is ready to be used
+		void tryStart()
+		{
+			if (!m_startPending || QProcess::state() != QProcess::NotRunning) {
+				return;
+			}
+
+			// If the probe fails, the process is started anyway, so the
+			// error is reported by QProcess
+			QMPCapabilityCache *cache = QMPCapabilityCache::instance();
+			if (!cache->contains(m_mplayerPath)) {
+				if (!m_probeRequested) {
+					m_probeRequested = true;
+					cache->probe(m_mplayerPath); // tryStart() will be called again
+					return;
+				}
+				if (cache->isProbing(m_mplayerPath)) {
+					return;
+				}
+			}
+			if (m_startWidget == NULL && m_mode == QMPwidget::EmbeddedMode) {
+				// The widget has been deleted in the meantime
+				m_startPending = false;
+				return;
+			}
+
+			m_startPending = false;
+			launch(m_startWidget, m_startArgs, cache->capabilities(m_mplayerPath));
+		}
+
+		void processStarted()
+		{
+			// Send commands that have been written in the meantime
+			flushCommands();
+			changeState(QMPwidget::IdleState);
+		}
+
+		// Writes all queued commands with a single write
+		void flushCommands()
+		{
+			QMP_TRACE_SCOPE("flushCommands");
+			m_flushPending = false;
+			if (isStarting() || QProcess::state() != QProcess::Running) {
+				return;
 			}
+			if (m_commands.isEmpty()) {
+				return;
+			}
+
+			QProcess::write(m_commands);
+			m_bytesWritten += m_commands.size();
+			m_commandsWritten += m_queuedCommands;
+			clearCommands();
 		}
 
 		void finished()
 		{
 			// Called if the *process* has finished
+			m_killTimer.stop();
+			m_queries.clear();
 			changeState(QMPwidget::NotStartedState);
+			if (m_deleteWhenFinished) {
+				deleteLater();
+				return;
+			}
+			tryStart();
+		}
+
+		void processError(QProcess::ProcessError code)
+		{
+			if (code == QProcess::FailedToStart) {
+				clearCommands();
+				m_queries.clear();
+				changeState(QMPwidget::ErrorState, errorString());
+				if (m_deleteWhenFinished) {
+					deleteLater();
+				}
+			}
 		}
 
 		void movieFinished()
@@ -420,94 +600,319 @@ class QMPProcess : public QProcess
 			}
 		}
 
+#ifdef QMP_USE_YUVPIPE
+		// MPlayer closes the YUV pipe at the end of a file, which is noticed
+		// earlier than the end of the status output
+		void streamEnded()
+		{
+			m_movieFinishedTimer.stop();
+			movieFinished();
+		}
+#endif
+
 	private:
+		// Schedules writing the queued commands
+		void commandQueued()
+		{
+			++m_queuedCommands;
+			if (!m_flushPending) {
+				m_flushPending = true;
+				QMetaObject::invokeMethod(this, "flushCommands", Qt::QueuedConnection);
+			}
+		}
+
+		// Discards all queued commands, keeping the buffer allocated
+		void clearCommands()
+		{
+			m_commands.resize(0);
+			m_queriesOffset = 0;
+			m_queuedCommands = 0;
+		}
+
+		// Sends the quit command and starts the kill timer
+		void requestQuit()
+		{
+			if (QProcess::state() == QProcess::NotRunning) {
+				return;
+			}
+			QProcess::write("quit\n");
+			m_killTimer.start();
+		}
+
+		// Reads all available data from the given channel and processes each
+		// complete line. Lines end with either '\n' or '\r' (which is used for
+		// the status line), and partial lines are kept until the next chunk of
+		// data arrives. The data is parsed as raw bytes, so strings are only
+		// created when they are actually needed.
+		void readLines(QProcess::ProcessChannel channel, QVarLengthArray<char, 512> *partial)
+		{
+			QProcess::ProcessChannel previous = readChannel();
+			setReadChannel(channel);
+
+			char chunk[4096];
+			qint64 n;
+			while ((n = QProcess::read(chunk, sizeof(chunk))) > 0) {
+				const char *p = chunk;
+				const char *end = chunk + n;
+				while (p < end) {
+					const char *eol = p;
+					while (eol < end && *eol != '\n' && *eol != '\r') {
+						++eol;
+					}
+					if (eol == end) {
+						partial->append(p, end - p);
+						break;
+					}
+
+					if (partial->isEmpty()) {
+						processLine(channel, p, eol - p);
+					} else {
+						partial->append(p, eol - p);
+						processLine(channel, partial->constData(), partial->size());
+						partial->resize(0);
+					}
+					p = eol + 1;
+				}
+			}
+
+			setReadChannel(previous);
+		}
+
+		// Parses a single line and emits it if anyone's listening
+		void processLine(QProcess::ProcessChannel channel, const char *line, int len)
+		{
+			if (len == 0) {
+				return;
+			}
+#ifdef QMP_DEBUG_OUTPUT
+			qDebug("%s: \"%.*s\"", (channel == QProcess::StandardOutput ? "out" : "err"), len, line);
+#endif
+
+			++m_linesParsed;
+			m_bytesParsed += len;
+			{
+				QMP_TRACE_SCOPE("parseLine");
+				parseLine(line, len);
+			}
+
+			if (channel == QProcess::StandardOutput) {
+				if (m_emitStdout) {
+					emit readStandardOutput(QString::fromLocal8Bit(line, len));
+				}
+			} else if (m_emitStderr) {
+				emit readStandardError(QString::fromLocal8Bit(line, len));
+			}
+		}
+
 		// Parses a line of MPlayer output
-		void parseLine(const QString &line)
+		void parseLine(const char *line, int len)
 		{
-			if (line.startsWith("Playing ")) {
-				changeState(QMPwidget::LoadingState);
-			} else if (line.startsWith("Cache fill:")) {
-				changeState(QMPwidget::BufferingState);
-			} else if (line.startsWith("Starting playback...")) {
-				m_mediaInfo.ok = true; // No more info here
-				changeState(QMPwidget::PlayingState);
-			} else if (line.startsWith("File not found: ")) {
-				changeState(QMPwidget::ErrorState);
-			} else if (line.endsWith("ID_PAUSED")) {
+			enum LineType {
+				StatusLine,
+				InfoLine,
+				PlayingLine,
+				CacheFillLine,
+				StartingLine,
+				FileNotFoundLine,
+				NoStreamLine,
+				ExitingLine,
+				AnswerLine,
+				PropertyErrorLine
+			};
+
+			struct Prefix {
+				const char *str;
+				int len;
+				LineType type;
+			};
+
+			// Ordered by frequency, status lines being the most common ones
+			static const Prefix prefixes[] = {
+				{"A:", 2, StatusLine},
+				{"V:", 2, StatusLine},
+				{"Cache fill:", 11, CacheFillLine},
+				{"ID_", 3, InfoLine},
+				{"ANS_", 4, AnswerLine},
+				{"Playing ", 8, PlayingLine},
+				{"Starting playback...", 20, StartingLine},
+				{"File not found: ", 16, FileNotFoundLine},
+				{"No stream found", 15, NoStreamLine},
+				{"Exiting...", 10, ExitingLine},
+				{"Failed to get value of property '", 33, PropertyErrorLine}
+			};
+
+			// The pause notification may follow other output on the same line
+			if (len >= 9 && memcmp(line + len - 9, "ID_PAUSED", 9) == 0) {
 				changeState(QMPwidget::PausedState);
-			} else if (line.startsWith("ID_")) {
-				parseMediaInfo(line);
-			} else if (line.startsWith("No stream found")) {
-				changeState(QMPwidget::ErrorState, line);
-			} else if (line.startsWith("A:") || line.startsWith("V:")) {
-				if (m_state != QMPwidget::PlayingState) {
-					changeState(QMPwidget::PlayingState);
+				return;
+			}
+
+			for (unsigned int i = 0; i < sizeof(prefixes) / sizeof(Prefix); i++) {
+				const Prefix &prefix = prefixes[i];
+				if (len < prefix.len || line[0] != prefix.str[0] || memcmp(line, prefix.str, prefix.len) != 0) {
+					continue;
+				}
+
+				switch (prefix.type) {
+					case StatusLine:
+						if (m_state != QMPwidget::PlayingState) {
+							changeState(QMPwidget::PlayingState);
+						}
+						parseStatus(line, len);
+						break;
+					case InfoLine:
+						parseMediaInfo(line, len);
+						break;
+					case PlayingLine:
+						changeState(QMPwidget::LoadingState);
+						break;
+					case CacheFillLine:
+						changeState(QMPwidget::BufferingState);
+						break;
+					case StartingLine:
+						m_mediaInfo.ok = true; // No more info here
+						changeState(QMPwidget::PlayingState);
+						break;
+					case FileNotFoundLine:
+						changeState(QMPwidget::ErrorState);
+						break;
+					case NoStreamLine:
+						changeState(QMPwidget::ErrorState, QString::fromLocal8Bit(line, len));
+						break;
+					case ExitingLine:
+						changeState(QMPwidget::NotStartedState);
+						break;
+					case AnswerLine:
+						parseAnswer(line, len);
+						break;
+					case PropertyErrorLine:
+						parsePropertyError(line, len);
+						break;
+				}
+				return;
+			}
+		}
+
+		// Parses a property value reported as "ANS_<name>=<value>"
+		void parseAnswer(const char *line, int len)
+		{
+			const char *eq = static_cast<const char *>(memchr(line, '=', len));
+			if (eq == NULL) {
+				return;
+			}
+
+			// Errors are matched by the "Failed to get value" message instead,
+			// since it contains the property name
+			const char *name = line + 4;
+			if (isKey(name, eq - name, "ERROR")) {
+				return;
+			}
+			answerQuery(name, eq - name, QString::fromLocal8Bit(eq + 1, line + len - eq - 1), true);
+		}
+
+		// Parses "Failed to get value of property '<name>'."
+		void parsePropertyError(const char *line, int len)
+		{
+			const char *name = line + 33;
+			const char *end = static_cast<const char *>(memchr(name, '\'', line + len - name));
+			if (end != NULL) {
+				answerQuery(name, end - name, QString(), false);
+			}
+		}
+
+		// Hands an answer to the matching pending query. MPlayer answers the
+		// queries in order, so earlier queries without an answer have failed.
+		// Answers to queries that haven't been sent by queryProperty() are
+		// ignored.
+		void answerQuery(const char *name, int len, const QString &value, bool ok)
+		{
+			for (int i = 0; i < m_queries.count(); i++) {
+				if (!isKey(name, len, m_queries[i].name.constData())) {
+					continue;
+				}
+
+				for (int j = 0; j < i; j++) {
+					PropertyQuery query = m_queries.takeFirst();
+					emit propertyError(query.id, QString::fromLatin1(query.name));
+				}
+				PropertyQuery query = m_queries.takeFirst();
+				if (ok) {
+					emit propertyReceived(query.id, QString::fromLatin1(query.name), value);
+				} else {
+					emit propertyError(query.id, QString::fromLatin1(query.name));
 				}
-				parsePosition(line);
-			} else if (line.startsWith("Exiting...")) {
-				changeState(QMPwidget::NotStartedState);
+				return;
 			}
 		}
 
 		// Parses MPlayer's media identification output
-		void parseMediaInfo(const QString &line)
+		void parseMediaInfo(const char *line, int len)
 		{
-			QStringList info = line.split("=");
-			if (info.count() < 2) {
+			const char *eq = static_cast<const char *>(memchr(line, '=', len));
+			if (eq == NULL) {
 				return;
 			}
 
-			if (info[0] == "ID_VIDEO_FORMAT") {
-				m_mediaInfo.videoFormat = info[1];
-			} else if (info[0] == "ID_VIDEO_BITRATE") {
-				m_mediaInfo.videoBitrate = info[1].toInt();
-			} else if (info[0] == "ID_VIDEO_WIDTH") {
-				m_mediaInfo.size.setWidth(info[1].toInt());
-			} else if (info[0] == "ID_VIDEO_HEIGHT") {
-				m_mediaInfo.size.setHeight(info[1].toInt());
-			} else if (info[0] == "ID_VIDEO_FPS") {
-				m_mediaInfo.framesPerSecond = info[1].toDouble();
-
-			} else if (info[0] == "ID_AUDIO_FORMAT") {
-				m_mediaInfo.audioFormat = info[1];
-			} else if (info[0] == "ID_AUDIO_BITRATE") {
-				m_mediaInfo.audioBitrate = info[1].toInt();
-			} else if (info[0] == "ID_AUDIO_RATE") {
-				m_mediaInfo.sampleRate = info[1].toInt();
-			} else if (info[0] == "ID_AUDIO_NCH") {
-				m_mediaInfo.numChannels = info[1].toInt();
-
-			} else if (info[0] == "ID_LENGTH") {
-				m_mediaInfo.length = info[1].toDouble();
-			} else if (info[0] == "ID_SEEKABLE") {
-				m_mediaInfo.seekable = (bool)info[1].toInt();
-
-			} else if (info[0].startsWith("ID_CLIP_INFO_NAME")) {
-				m_currentTag = info[1];
-			} else if (info[0].startsWith("ID_CLIP_INFO_VALUE") && !m_currentTag.isEmpty()) {
-				m_mediaInfo.tags.insert(m_currentTag, info[1]);
+			const int klen = eq - line;
+			const char *value = eq + 1;
+			const char *end = line + len;
+
+			if (isKey(line, klen, "ID_VIDEO_FORMAT")) {
+				m_mediaInfo.videoFormat = QString::fromLocal8Bit(value, end - value);
+			} else if (isKey(line, klen, "ID_VIDEO_BITRATE")) {
+				m_mediaInfo.videoBitrate = parseInt(value, end);
+			} else if (isKey(line, klen, "ID_VIDEO_WIDTH")) {
+				m_mediaInfo.size.setWidth(parseInt(value, end));
+			} else if (isKey(line, klen, "ID_VIDEO_HEIGHT")) {
+				m_mediaInfo.size.setHeight(parseInt(value, end));
+			} else if (isKey(line, klen, "ID_VIDEO_FPS")) {
+				m_mediaInfo.framesPerSecond = parseDouble(value, end);
+
+			} else if (isKey(line, klen, "ID_AUDIO_FORMAT")) {
+				m_mediaInfo.audioFormat = QString::fromLocal8Bit(value, end - value);
+			} else if (isKey(line, klen, "ID_AUDIO_BITRATE")) {
+				m_mediaInfo.audioBitrate = parseInt(value, end);
+			} else if (isKey(line, klen, "ID_AUDIO_RATE")) {
+				m_mediaInfo.sampleRate = parseInt(value, end);
+			} else if (isKey(line, klen, "ID_AUDIO_NCH")) {
+				m_mediaInfo.numChannels = parseInt(value, end);
+
+			} else if (isKey(line, klen, "ID_LENGTH")) {
+				m_mediaInfo.length = parseDouble(value, end);
+			} else if (isKey(line, klen, "ID_SEEKABLE")) {
+				m_mediaInfo.seekable = (bool)parseInt(value, end);
+
+			} else if (klen > 17 && memcmp(line, "ID_CLIP_INFO_NAME", 17) == 0) {
+				m_currentTag = QString::fromLocal8Bit(value, end - value);
+			} else if (klen > 18 && memcmp(line, "ID_CLIP_INFO_VALUE", 18) == 0 && !m_currentTag.isEmpty()) {
+				m_mediaInfo.tags.insert(m_currentTag, QString::fromLocal8Bit(value, end - value));
 			}
 		}
 
-		// Parsas MPlayer's position output
-		void parsePosition(const QString &line)
+		// Parses MPlayer's status line and updates the stream position
+		void parseStatus(const char *line, int len)
 		{
-			static QRegExp rx("[ :]");
-			QStringList info = line.split(rx, QString::SkipEmptyParts);
+			QMPwidget::PlaybackStatus status;
+			scanStatus(line, len, &status);
 
+			// The video position takes precedence for the stream position
 			double oldpos = m_streamPosition;
-			for (int i = 0; i < info.count(); i++) {
-				if ( (info[i] == "V" || info[i] == "A") && info.count() > i) {
-					m_streamPosition = info[i+1].toDouble();
-
-					// If the movie is near its end, start a timer that will check whether
-					// the movie has really finished.
-					if (qAbs(m_streamPosition - m_mediaInfo.length) < 1) {
-						m_movieFinishedTimer.start();
-					}
-				}
+			if (status.videoPosition >= 0) {
+				m_streamPosition = status.videoPosition;
+			} else if (status.audioPosition >= 0) {
+				m_streamPosition = status.audioPosition;
+			}
+			m_playbackStatus = status;
+
+			// If the movie is near its end, start a timer that will check whether
+			// the movie has really finished.
+			if (qAbs(m_streamPosition - m_mediaInfo.length) < 1) {
+				m_movieFinishedTimer.start();
 			}
 
+			if (m_emitStatus) {
+				emit playbackStatusChanged(m_playbackStatus);
+			}
 			if (oldpos != m_streamPosition) {
 				emit streamPositionChanged(m_streamPosition);
 			}
@@ -518,8 +923,8 @@ class QMPProcess : public QProcess
 		{
 #ifdef QMP_USE_YUVPIPE
 			if (m_yuvReader != NULL && (state == QMPwidget::ErrorState || state == QMPwidget::NotStartedState)) {
-				m_yuvReader->stop();
-				m_yuvReader->deleteLater();
+				m_yuvReader->stop(); // Deletes the reader later
+				m_yuvReader = NULL;
 			}
 #endif
 
@@ -531,6 +936,7 @@ class QMPProcess : public QProcess
 				m_movieFinishedTimer.stop();
 			}
 
+			QMP_TRACE_EVENT("stateChanged", state);
 			m_state = state;
 			emit stateChanged(m_state);
 
@@ -552,27 +958,16 @@ class QMPProcess : public QProcess
 		void resetValues()
 		{
 			m_mediaInfo = QMPwidget::MediaInfo();
+			m_playbackStatus = QMPwidget::PlaybackStatus();
 			m_streamPosition = -1;
 		}
 
-		// Writes a dummy input configuration to the given device
-		void writeFakeInputconf(QIODevice *device)
+		// Writes a dummy input configuration for the given keys to a device
+		void writeFakeInputconf(QIODevice *device, const QStringList &keys)
 		{
-			// Query list of supported keys
-			QProcess p;
-			p.start(m_mplayerPath, QStringList("-input") += "keylist");
-			if (!p.waitForStarted()) {
-				return;
-			}
-			if (!p.waitForFinished()) {
-				return;
-			}
-			QStringList keys = QString(p.readAll()).split("\n", QString::SkipEmptyParts);
-
 			// Write dummy command for each key
 			QTextStream out(device);
 			for (int i = 0; i < keys.count(); i++) {
-				keys[i].remove("\r");
 				out << keys[i] << " " << "ignored" << endl;
 			}
 		}
@@ -584,41 +979,260 @@ class QMPProcess : public QProcess
 		QString m_videoOutput;
 		QString m_pipe;
 		QMPwidget::Mode m_mode;
+		int m_conversionThreads;
+		Qt::TransformationMode m_scalingMode;
+		int m_frameQueueSize;
+		QMPwidget::FrameDropPolicy m_frameDropPolicy;
+		int m_pipeBufferSize;
 
 		QMPwidget::MediaInfo m_mediaInfo;
 		double m_streamPosition; // This is the video position
+		QMPwidget::PlaybackStatus m_playbackStatus;
 		QTimer m_movieFinishedTimer;
 
 		QString m_currentTag;
 
+		// Output parsing
+		QVarLengthArray<char, 512> m_stdoutLine;
+		QVarLengthArray<char, 512> m_stderrLine;
+		quint64 m_linesParsed;
+		quint64 m_bytesParsed;
+		bool m_emitStdout;
+		bool m_emitStderr;
+		bool m_emitStatus;
+
+		// Asynchronous startup and shutdown
+		bool m_startPending;
+		bool m_probeRequested;
+		QPointer<QWidget> m_startWidget;
+		QStringList m_startArgs;
+
+		// Command queue. Property queries at the end of the queue start at
+		// m_queriesOffset, which is where priority commands are inserted.
+		QByteArray m_commands;
+		int m_queriesOffset;
+		int m_queuedCommands;
+		bool m_flushPending;
+		quint64 m_commandsWritten;
+		quint64 m_bytesWritten;
+
+		// Pending property queries, in the order they have been written
+		struct PropertyQuery {
+			int id;
+			QByteArray name;
+			QTime time;
+		};
+		QList<PropertyQuery> m_queries;
+		QTimer m_killTimer;
+		bool m_deleteWhenFinished;
+
 		QTemporaryFile *m_fakeInputconf;
 
 #ifdef QMP_USE_YUVPIPE
 		QPointer<QMPYuvReader> m_yuvReader;
+		QSharedPointer<QMPFrameQueue> m_frameQueue;
 #endif
 };
 
 
-// Initialize the media info structure
-QMPwidget::MediaInfo::MediaInfo()
-	: videoBitrate(0), framesPerSecond(0), sampleRate(0), numChannels(0),
-	  ok(false), length(0), seekable(false)
+#ifdef QMP_USE_YUVPIPE
+
+// Internal pool of idle MPlayer processes in pipe mode. The processes are
+// started in advance and handed to widgets on start(), which hides the
+// process startup latency. Embedded mode can't be supported, since the
+// target window has to be known when MPlayer is started.
+class QMPProcessPool : public QObject
 {
+	Q_OBJECT
 
-}
+	public:
+		// Returns the global instance
+		static QMPProcessPool *instance()
+		{
+			static QMPProcessPool *pool = NULL;
+			if (pool == NULL) {
+				pool = new QMPProcessPool(QCoreApplication::instance());
+			}
+			return pool;
+		}
 
+		// Sets the number of idle processes and the way they are started.
+		// Processes that don't match the new configuration are terminated.
+		void configure(int size, const QStringList &args, const QString &mplayerPath)
+		{
+			bool changed = (args != m_args || mplayerPath != m_mplayerPath);
+			m_size = qMax(size, 0);
+			m_args = args;
+			m_mplayerPath = mplayerPath;
 
-/*!
- * \brief Constructor
+			while (!m_processes.isEmpty() && (changed || m_processes.count() > m_size)) {
+				release(m_processes.takeLast());
+			}
+			scheduleRefill();
+		}
+
+		int size() const
+		{
+			return m_size;
+		}
+
+		// Takes a process that has been started with the given arguments
+		// from the pool, or returns NULL if there's none
+		QMPProcess *take(const QString &mplayerPath, const QStringList &args)
+		{
+			if (m_processes.isEmpty() || args != m_args || mplayerPath != m_mplayerPath) {
+				return NULL;
+			}
+
+			// Prefer processes that are ready already
+			int index = 0;
+			for (int i = 0; i < m_processes.count(); i++) {
+				if (m_processes[i]->m_state == QMPwidget::IdleState) {
+					index = i;
+					break;
+				}
+			}
+
+			QMPProcess *process = m_processes.takeAt(index);
+			disconnect(process, 0, this, 0);
+			scheduleRefill();
+			return process;
+		}
+
+	private slots:
+		void refill()
+		{
+			m_refillPending = false;
+			while (m_processes.count() < m_size) {
+				QMPProcess *process = new QMPProcess(this);
+				process->m_mode = QMPwidget::PipeMode;
+				process->m_mplayerPath = m_mplayerPath;
+				connect(process, SIGNAL(stateChanged(int)), this, SLOT(processStateChanged(int)));
+				process->start(NULL, m_args);
+				m_processes.append(process);
+			}
+		}
+
+		// Replaces processes that have died
+		void processStateChanged(int state)
+		{
+			if (state != QMPwidget::NotStartedState && state != QMPwidget::ErrorState) {
+				return;
+			}
+			QMPProcess *process = qobject_cast<QMPProcess *>(sender());
+			if (m_processes.removeOne(process)) {
+				disconnect(process, 0, this, 0);
+				process->deleteLater();
+				if (state == QMPwidget::NotStartedState) {
+					scheduleRefill();
+				}
+			}
+		}
+
+	private:
+		QMPProcessPool(QObject *parent = 0)
+			: QObject(parent), m_size(0), m_refillPending(false)
+		{
+
+		}
+
+		// Refills the pool once control returns to the event loop
+		void scheduleRefill()
+		{
+			if (!m_refillPending && m_processes.count() < m_size) {
+				m_refillPending = true;
+				QTimer::singleShot(0, this, SLOT(refill()));
+			}
+		}
+
+		void release(QMPProcess *process)
+		{
+			disconnect(process, 0, this, 0);
+			if (process->processState() != QProcess::NotRunning) {
+				process->quitAndDelete();
+			} else {
+				delete process;
+			}
+		}
+
+	private:
+		QList<QMPProcess *> m_processes;
+		int m_size;
+		QStringList m_args;
+		QString m_mplayerPath;
+		bool m_refillPending;
+};
+
+#endif // QMP_USE_YUVPIPE
+
+
+// Global notification rate, used by all widgets that don't have their own
+static int s_globalNotificationRate = 0;
+
+// Property query id used for detecting when a seek has been finished
+static const int s_seekQueryId = -1;
+
+// Property query id of the pause query that is sent before loading a file
+static const int s_loadQueryId = -2;
+
+// Property query id used for checking whether the standby process is paused
+static const int s_standbyQueryId = -3;
+
+
+// Initialize the media info structure
+QMPwidget::MediaInfo::MediaInfo()
+	: videoBitrate(0), framesPerSecond(0), sampleRate(0), numChannels(0),
+	  ok(false), length(0), seekable(false)
+{
+
+}
+
+// Initialize the playback status structure
+QMPwidget::PlaybackStatus::PlaybackStatus()
+	: audioPosition(-1), videoPosition(-1), audioVideoDelay(0), totalCorrection(0),
+	  playedFrames(-1), decodedFrames(-1), droppedFrames(-1),
+	  videoCodecUsage(-1), videoOutputUsage(-1), audioCodecUsage(-1), postprocessingLevel(-1), cacheFill(-1)
+{
+
+}
+
+// Initialize the latency structure
+QMPwidget::Latency::Latency()
+	: samples(0), median(0), p90(0), p99(0)
+{
+
+}
+
+// Initialize the statistics structure
+QMPwidget::Statistics::Statistics()
+	: framesRead(0), framesConverted(0), framesPresented(0), framesDropped(0), framesSkipped(0), framesLate(0), readCallsPerFrame(0),
+	  audioVideoDelay(0), mplayerDroppedFrames(-1),
+	  linesParsed(0), bytesParsed(0), commandsWritten(0), commandBytesWritten(0)
+{
+
+}
+
+
+/*!
+ * \brief Constructor
  *
  * \param parent Parent widget
  */
 QMPwidget::QMPwidget(QWidget *parent)
-	: QWidget(parent)
+	: QWidget(parent), m_process(NULL), m_seekPending(false), m_seekOffset(0), m_seekWhence(AbsoluteSeek),
+	  m_seekPrecision(0), m_seekInFlight(false), m_seekStart(0), m_seekLatency(-1),
+	  m_notificationRate(-1), m_positionPending(false), m_statusPending(false),
+	  m_playlistLoop(false), m_playlistIndex(-1), m_itemPlaying(false), m_standby(NULL), m_standbyIndex(-1), m_standbyReady(false),
+	  m_lastPropertyId(0)
 {
 	setFocusPolicy(Qt::StrongFocus);
 	setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
 
+	// Allow queued connections to the status signals
+	qRegisterMetaType<QMPwidget::PlaybackStatus>("QMPwidget::PlaybackStatus");
+	qRegisterMetaType<QMPwidget::Statistics>("QMPwidget::Statistics");
+	QMP_TRACE_THREAD("GUI");
+
 #ifdef QT_OPENGL_LIB
 	m_widget = new QMPOpenGLVideoWidget(this);
 #else
@@ -629,30 +1243,36 @@ QMPwidget::QMPwidget(QWidget *parent)
 	p.setColor(QPalette::Window, Qt::black);
 	setPalette(p);
 
-	m_seekTimer.setInterval(50);
 	m_seekTimer.setSingleShot(true);
 	connect(&m_seekTimer, SIGNAL(timeout()), this, SLOT(delayedSeek()));
 
+	m_notificationTimer.setSingleShot(true);
+	connect(&m_notificationTimer, SIGNAL(timeout()), this, SLOT(notify()));
+
+	connect(&m_pollTimer, SIGNAL(timeout()), this, SLOT(pollProperties()));
+	connect(&m_statisticsTimer, SIGNAL(timeout()), this, SLOT(emitStatistics()));
+
 	m_process = new QMPProcess(this);
-	connect(m_process, SIGNAL(stateChanged(int)), this, SLOT(mpStateChanged(int)));
-	connect(m_process, SIGNAL(streamPositionChanged(double)), this, SLOT(mpStreamPositionChanged(double)));
-	connect(m_process, SIGNAL(error(const QString &)), this, SIGNAL(error(const QString &)));
-	connect(m_process, SIGNAL(readStandardOutput(const QString &)), this, SIGNAL(readStandardOutput(const QString &)));
-	connect(m_process, SIGNAL(readStandardError(const QString &)), this, SIGNAL(readStandardError(const QString &)));
+	QMPCapabilityCache::instance()->probe(m_process->m_mplayerPath);
+	connectProcess();
 }
 
 /*!
  * \brief Destructor
  * \details
- * This function will ask the MPlayer process to quit and block until it has really
- * finished.
+ * This function will ask the MPlayer process to quit, but won't wait for it.
+ * The process will quit in the background and will be killed if it doesn't
+ * quit in time.
  */
 QMPwidget::~QMPwidget()
 {
-	if (m_process->processState() == QProcess::Running) {
-		m_process->quit();
+	discardStandby();
+	if (m_process->processState() != QProcess::NotRunning) {
+		m_process->quitAndDelete();
+	} else {
+		delete m_process;
 	}
-	delete m_process;
+	m_process = NULL;
 }
 
 /*!
@@ -727,6 +1347,365 @@ QMPwidget::Mode QMPwidget::mode() const
 	return m_process->m_mode;
 }
 
+/*!
+ * \brief Sets the number of threads used for converting video frames
+ * \details
+ * In \ref playbackmodes "pipe mode", each frame is split into horizontal bands
+ * which are converted in parallel by a pool of worker threads. If \p threads
+ * is 0, QThread::idealThreadCount() threads will be used. The default value
+ * is 1, i.e. frames are converted in the reader thread only.
+ *
+ * This setting can be changed during playback.
+ *
+ * \param threads Number of conversion threads
+ * \sa conversionThreads()
+ */
+void QMPwidget::setConversionThreads(int threads)
+{
+	m_process->m_conversionThreads = qMax(0, threads);
+#ifdef QMP_USE_YUVPIPE
+	if (m_process->m_yuvReader != NULL) {
+		m_process->m_yuvReader->setThreadCount(m_process->m_conversionThreads);
+	}
+#endif
+}
+
+/*!
+ * \brief Returns the number of threads used for converting video frames
+ *
+ * \returns The number of conversion threads, or 0 for automatic selection
+ * \sa setConversionThreads()
+ */
+int QMPwidget::conversionThreads() const
+{
+	return m_process->m_conversionThreads;
+}
+
+/*!
+ * \brief Sets the filter used for scaling video frames
+ * \details
+ * If the video is displayed at a different size in \ref playbackmodes "pipe mode",
+ * frames are resampled while converting them to RGB, so the conversion only
+ * needs to be done for the displayed pixels. Qt::FastTransformation uses the
+ * nearest samples, and Qt::SmoothTransformation (the default) uses bilinear
+ * interpolation. This doesn't apply if the frames are converted by the
+ * graphics hardware using OpenGL.
+ *
+ * This setting can be changed during playback.
+ *
+ * \param mode Scaling filter
+ * \sa scalingMode()
+ */
+void QMPwidget::setScalingMode(Qt::TransformationMode mode)
+{
+	m_process->m_scalingMode = mode;
+#ifdef QMP_USE_YUVPIPE
+	if (m_process->m_yuvReader != NULL) {
+		m_process->m_yuvReader->setScalingMode(mode);
+	}
+#endif
+}
+
+/*!
+ * \brief Returns the filter used for scaling video frames
+ *
+ * \returns The scaling filter
+ * \sa setScalingMode()
+ */
+Qt::TransformationMode QMPwidget::scalingMode() const
+{
+	return m_process->m_scalingMode;
+}
+
+/*!
+ * \brief Sets the size of the frame queue
+ * \details
+ * In \ref playbackmodes "pipe mode", decoded frames are stored in a bounded
+ * queue until they are displayed. This function sets the maximum number of
+ * frames waiting in the queue. Larger queues may even out short stalls of the
+ * GUI thread at the expense of latency. The default size is 1.
+ *
+ * \param size Maximum number of queued frames
+ * \sa frameQueueSize(), setFrameDropPolicy()
+ */
+void QMPwidget::setFrameQueueSize(int size)
+{
+	m_process->m_frameQueueSize = qMax(size, 1);
+#ifdef QMP_USE_YUVPIPE
+	if (m_process->m_frameQueue) {
+		m_process->m_frameQueue->setSize(m_process->m_frameQueueSize);
+	}
+#endif
+}
+
+/*!
+ * \brief Returns the size of the frame queue
+ *
+ * \returns The maximum number of queued frames
+ * \sa setFrameQueueSize()
+ */
+int QMPwidget::frameQueueSize() const
+{
+	return m_process->m_frameQueueSize;
+}
+
+/*!
+ * \brief Sets the policy for frames that don't fit into the frame queue
+ * \details
+ * Please see QMPwidget::FrameDropPolicy for a description of the available
+ * policies. The default policy is QMPwidget::DropOldestFrame.
+ *
+ * \param policy Frame drop policy
+ * \sa frameDropPolicy(), setFrameQueueSize(), droppedFrames()
+ */
+void QMPwidget::setFrameDropPolicy(FrameDropPolicy policy)
+{
+	m_process->m_frameDropPolicy = policy;
+#ifdef QMP_USE_YUVPIPE
+	if (m_process->m_frameQueue) {
+		m_process->m_frameQueue->setPolicy(policy);
+	}
+#endif
+}
+
+/*!
+ * \brief Returns the policy for frames that don't fit into the frame queue
+ *
+ * \returns The frame drop policy
+ * \sa setFrameDropPolicy()
+ */
+QMPwidget::FrameDropPolicy QMPwidget::frameDropPolicy() const
+{
+	return m_process->m_frameDropPolicy;
+}
+
+/*!
+ * \brief Returns the number of dropped frames
+ * \details
+ * This is the number of frames that have been read in \ref playbackmodes "pipe mode",
+ * but have been dropped because the frame queue was full. The counter is
+ * reset when the MPlayer process is started.
+ *
+ * \returns The number of dropped frames
+ * \sa setFrameDropPolicy()
+ */
+quint64 QMPwidget::droppedFrames() const
+{
+#ifdef QMP_USE_YUVPIPE
+	if (m_process->m_frameQueue) {
+		return m_process->m_frameQueue->droppedFrames();
+	}
+#endif
+	return 0;
+}
+
+#ifdef QMP_USE_YUVPIPE
+// Returns the presentation scheduler of a video widget
+static QMPFrameScheduler *frameScheduler(QWidget *widget)
+{
+ #ifdef QT_OPENGL_LIB
+	return qobject_cast<QMPOpenGLVideoWidget *>(widget)->scheduler();
+ #else
+	return qobject_cast<QMPPlainVideoWidget *>(widget)->scheduler();
+ #endif
+}
+#endif
+
+/*!
+ * \brief Sets the refresh rate of the display
+ * \details
+ * In \ref playbackmodes "pipe mode", at most one frame is presented per
+ * display refresh, and frames that are presented more than a refresh
+ * interval after their presentation time are counted as late. Qt doesn't
+ * report the refresh rate of the screen, so it is assumed to be 60 Hz
+ * unless set by this function.
+ *
+ * \param rate Refresh rate in Hz
+ * \sa refreshRate(), lateFrames()
+ */
+void QMPwidget::setRefreshRate(double rate)
+{
+#ifdef QMP_USE_YUVPIPE
+	frameScheduler(m_widget)->setRefreshRate(rate);
+#else
+	Q_UNUSED(rate);
+#endif
+}
+
+/*!
+ * \brief Returns the refresh rate of the display
+ *
+ * \returns The refresh rate in Hz
+ * \sa setRefreshRate()
+ */
+double QMPwidget::refreshRate() const
+{
+#ifdef QMP_USE_YUVPIPE
+	return frameScheduler(m_widget)->refreshRate();
+#else
+	return 60;
+#endif
+}
+
+/*!
+ * \brief Returns the number of presented frames
+ * \details
+ * In \ref playbackmodes "pipe mode", frames are presented according to the
+ * frame rate of the video, at most one per display refresh. The counters of
+ * presented, skipped and late frames are reset when the MPlayer process is
+ * started.
+ *
+ * \returns The number of frames that have been presented
+ * \sa skippedFrames(), lateFrames(), droppedFrames(), setRefreshRate()
+ */
+quint64 QMPwidget::presentedFrames() const
+{
+#ifdef QMP_USE_YUVPIPE
+	return frameScheduler(m_widget)->presentedFrames();
+#else
+	return 0;
+#endif
+}
+
+/*!
+ * \brief Returns the number of skipped frames
+ * \details
+ * Frames are skipped if a newer frame was due at presentation time, e.g.
+ * because painting took too long.
+ *
+ * \returns The number of frames that have been skipped
+ * \sa presentedFrames()
+ */
+quint64 QMPwidget::skippedFrames() const
+{
+#ifdef QMP_USE_YUVPIPE
+	return frameScheduler(m_widget)->skippedFrames();
+#else
+	return 0;
+#endif
+}
+
+/*!
+ * \brief Returns the number of frames that have been presented late
+ * \details
+ * A frame is late if it has been presented more than a display refresh
+ * interval after its presentation time.
+ *
+ * \returns The number of late frames
+ * \sa presentedFrames(), setRefreshRate()
+ */
+quint64 QMPwidget::lateFrames() const
+{
+#ifdef QMP_USE_YUVPIPE
+	return frameScheduler(m_widget)->lateFrames();
+#else
+	return 0;
+#endif
+}
+
+/*!
+ * \brief Returns the most recent playback status
+ * \details
+ * The playback status is parsed from the status line MPlayer prints during
+ * playback. Please note that fields which are not printed by MPlayer are set
+ * to -1.
+ *
+ * \returns The current playback status
+ * \sa playbackStatusChanged()
+ */
+QMPwidget::PlaybackStatus QMPwidget::playbackStatus() const
+{
+	return m_process->m_playbackStatus;
+}
+
+/*!
+ * \brief Limits the rate of position and status notifications
+ * \details
+ * MPlayer prints its status line for every frame, which may be too much for
+ * user interfaces showing lots of widgets. This function limits the number of
+ * streamPositionChanged() and playbackStatusChanged() signals (and seek slider
+ * updates) to \p rate per second. Updates arriving in between are coalesced,
+ * i.e. only the most recent values will be delivered.
+ *
+ * A rate of 0 disables the limit. If \p rate is negative, the global rate
+ * set with setGlobalNotificationRate() will be used, which is the default.
+ *
+ * \param rate Maximum number of notifications per second
+ * \sa notificationRate(), setGlobalNotificationRate()
+ */
+void QMPwidget::setNotificationRate(int rate)
+{
+	m_notificationRate = qMax(rate, -1);
+}
+
+/*!
+ * \brief Returns the rate limit of position and status notifications
+ *
+ * \returns The maximum number of notifications per second, 0 if unlimited
+ *          or -1 if the global rate is used
+ * \sa setNotificationRate()
+ */
+int QMPwidget::notificationRate() const
+{
+	return m_notificationRate;
+}
+
+/*!
+ * \brief Limits the rate of position and status notifications globally
+ * \details
+ * This rate is used by all widgets that don't have their own rate (see
+ * setNotificationRate()). A rate of 0 disables the limit, which is the
+ * default.
+ *
+ * \param rate Maximum number of notifications per second and widget
+ * \sa globalNotificationRate()
+ */
+void QMPwidget::setGlobalNotificationRate(int rate)
+{
+	s_globalNotificationRate = qMax(rate, 0);
+}
+
+/*!
+ * \brief Returns the global rate limit of position and status notifications
+ *
+ * \returns The maximum number of notifications per second and widget, or 0 if unlimited
+ * \sa setGlobalNotificationRate()
+ */
+int QMPwidget::globalNotificationRate()
+{
+	return s_globalNotificationRate;
+}
+
+/*!
+ * \brief Sets the buffer size used for reading video frames
+ * \details
+ * In \ref playbackmodes "pipe mode", the frame data written by MPlayer is
+ * read in large blocks. This function sets the size of the read buffer in
+ * bytes. On Linux, the capacity of the pipe will be enlarged to this size as
+ * well (as far as permitted by the system), so MPlayer can write larger parts
+ * of a frame at once. The default size is 1 MiB.
+ *
+ * The new size will be used when the MPlayer process is started.
+ *
+ * \param size Buffer size in bytes
+ * \sa pipeBufferSize()
+ */
+void QMPwidget::setPipeBufferSize(int size)
+{
+	m_process->m_pipeBufferSize = qMax(size, 4096);
+}
+
+/*!
+ * \brief Returns the buffer size used for reading video frames
+ *
+ * \returns The buffer size in bytes
+ * \sa setPipeBufferSize()
+ */
+int QMPwidget::pipeBufferSize() const
+{
+	return m_process->m_pipeBufferSize;
+}
+
 /*!
  * \brief Sets the video output mode
  * \details
@@ -797,6 +1776,7 @@ QString QMPwidget::videoOutput() const
 void QMPwidget::setMPlayerPath(const QString &path)
 {
 	m_process->m_mplayerPath = path;
+	QMPCapabilityCache::instance()->probe(path);
 }
 
 /*!
@@ -813,16 +1793,166 @@ QString QMPwidget::mplayerPath() const
 /*!
  * \brief Returns the version string of the MPlayer executable
  * \details
- * If the mplayer  
- *
+ * The capabilities of MPlayer executables are probed once and shared by all
+ * widgets. If the executable has not been probed yet, this function blocks
+ * until the probe has finished, but for at most three seconds. If the probe
+ * takes longer or fails, an empty string is returned.
  *
  * \returns The version string of the MPlayer executable
+ * \sa supportedVideoOutputs(), setCapabilityCachePersistent()
  */
 QString QMPwidget::mplayerVersion()
 {
 	return m_process->mplayerVersion();
 }
 
+/*!
+ * \brief Returns the video output drivers supported by the MPlayer executable
+ * \details
+ * Like mplayerVersion(), this function may block for up to three seconds if
+ * the executable has not been probed yet.
+ *
+ * \returns A list of driver names that may be used with setVideoOutput()
+ * \sa mplayerVersion()
+ */
+QStringList QMPwidget::supportedVideoOutputs()
+{
+	return QMPCapabilityCache::instance()->capabilities(m_process->m_mplayerPath, true).videoOutputs;
+}
+
+/*!
+ * \brief Enables storing the capabilities of MPlayer executables on disk
+ * \details
+ * The capabilities (i.e. the version, the supported video outputs and the
+ * supported key bindings) of each MPlayer executable are determined once per
+ * application by running it in the background. If the persistent cache is
+ * enabled, the results will be stored using QSettings and re-used as long
+ * as the executable is not modified. This is disabled per default.
+ *
+ * \param persistent true if the capabilities should be stored on disk
+ * \sa mplayerVersion()
+ */
+void QMPwidget::setCapabilityCachePersistent(bool persistent)
+{
+	QMPCapabilityCache::instance()->setPersistent(persistent);
+}
+
+/*!
+ * \brief Writes recorded trace events to a file
+ * \details
+ * If %QMPwidget has been built with the QMake configuration variable
+ * \p tracing set, the reader thread, the MPlayer process handling and the
+ * video widgets record trace events into per-thread ring buffers, which keep
+ * the most recent events only. This function writes them in the Chrome trace
+ * event format, which can be viewed using \p chrome://tracing or Perfetto.
+ *
+ * \param fileName Name of the output file
+ * \returns false if tracing is disabled or the file couldn't be written
+ */
+bool QMPwidget::saveTrace(const QString &fileName)
+{
+#ifdef QMP_USE_TRACING
+	return QMPTrace::save(fileName);
+#else
+	Q_UNUSED(fileName);
+	return false;
+#endif
+}
+
+/*!
+ * \brief Configures a pool of pre-started MPlayer processes
+ * \details
+ * Starting MPlayer takes some time, which is noticeable if the played media
+ * is changed often (e.g. when zapping through channels). If the pool is
+ * enabled, \p size MPlayer processes will be kept running in idle
+ * \ref playbackmodes "pipe mode", and start() will take one from the pool
+ * if the same arguments and MPlayer executable are used. The pool is refilled
+ * in the background. Embedded mode can't be supported, since the target window
+ * has to be known when starting MPlayer.
+ *
+ * The pool is disabled per default. Passing a size of 0 disables it again.
+ *
+ * \param size Number of idle processes
+ * \param args MPlayer command line arguments, as passed to start()
+ * \param mplayerPath Path to the MPlayer executable
+ * \sa processPoolSize()
+ */
+void QMPwidget::setProcessPool(int size, const QStringList &args, const QString &mplayerPath)
+{
+#ifdef QMP_USE_YUVPIPE
+	QMPProcessPool::instance()->configure(size, args, mplayerPath);
+#else
+	Q_UNUSED(size);
+	Q_UNUSED(args);
+	Q_UNUSED(mplayerPath);
+#endif
+}
+
+/*!
+ * \brief Returns the size of the process pool
+ *
+ * \returns The number of idle processes kept in the pool
+ * \sa setProcessPool()
+ */
+int QMPwidget::processPoolSize()
+{
+#ifdef QMP_USE_YUVPIPE
+	return QMPProcessPool::instance()->size();
+#else
+	return 0;
+#endif
+}
+
+/*!
+ * \brief Sets a list of media items for continuous playback
+ * \details
+ * Once an item has been played completely, the next one will be loaded
+ * automatically. Playback of the playlist is started with loadItem().
+ *
+ * In \ref playbackmodes "pipe mode", the next item is preloaded in a second,
+ * paused MPlayer process while the current item is playing. As soon as
+ * MPlayer has written the last frame of the current item, the second process
+ * resumes playback and takes over the video widget, so there's no gap for
+ * opening and initializing the next item.
+ * If available, the process will be taken from the pool configured with
+ * setProcessPool(). In embedded mode, the items will be loaded in the same
+ * process one after another.
+ *
+ * \param urls File paths or urls
+ * \param loop Whether to start over after the last item
+ * \sa loadItem(), loadNext(), currentItemChanged()
+ */
+void QMPwidget::setPlaylist(const QStringList &urls, bool loop)
+{
+	discardStandby();
+	m_playlist = urls;
+	m_playlistLoop = loop;
+	m_playlistIndex = -1;
+	m_itemPlaying = false;
+}
+
+/*!
+ * \brief Returns the current playlist
+ *
+ * \returns The list of media items
+ * \sa setPlaylist()
+ */
+QStringList QMPwidget::playlist() const
+{
+	return m_playlist;
+}
+
+/*!
+ * \brief Returns the index of the playlist item that is currently played
+ *
+ * \returns The index of the current item or -1 if the playlist isn't played
+ * \sa loadItem(), currentItemChanged()
+ */
+int QMPwidget::currentItem() const
+{
+	return m_playlistIndex;
+}
+
 /*!
  * \brief Sets a seeking slider for this widget
  */
@@ -841,6 +1971,7 @@ void QMPwidget::setSeekSlider(QAbstractSlider *slider)
 	}
 
 	connect(slider, SIGNAL(valueChanged(int)), this, SLOT(seek(int)));
+	connect(slider, SIGNAL(sliderReleased()), this, SLOT(seekSliderReleased()));
 	m_seekSlider = slider;
 }
 
@@ -902,13 +2033,28 @@ QSize QMPwidget::sizeHint() const
  * If there's another process running, it will be terminated first. MPlayer
  * will be run in idle mode and is avaiting your commands, e.g. via load().
  *
+ * This function returns immediately. Once MPlayer is ready, the state will
+ * change to QMPwidget::IdleState. Commands (like load()) that are issued
+ * before will be sent to MPlayer as soon as it has been started.
+ *
+ * In \ref playbackmodes "pipe mode", a process from the pool configured with
+ * setProcessPool() will be used if it has been started with the same
+ * arguments.
+ *
  * \param args MPlayer command line arguments
+ * \sa stateChanged()
  */
 void QMPwidget::start(const QStringList &args)
 {
-	if (m_process->processState() == QProcess::Running) {
-		m_process->quit();
+#ifdef QMP_USE_YUVPIPE
+	if (m_process->m_mode == PipeMode) {
+		QMPProcess *process = QMPProcessPool::instance()->take(m_process->m_mplayerPath, args);
+		if (process != NULL) {
+			adoptProcess(process);
+			return;
+		}
 	}
+#endif
 	m_process->start(m_widget, args);
 }
 
@@ -919,18 +2065,81 @@ void QMPwidget::start(const QStringList &args)
  */
 void QMPwidget::load(const QString &url)
 {
-	Q_ASSERT_X(m_process->state() != QProcess::NotRunning, "QMPwidget::load()", "MPlayer process not started yet");
+	Q_ASSERT_X(m_process->state() != QProcess::NotRunning || m_process->isStarting(), "QMPwidget::load()", "MPlayer process not started yet");
+
+	// Leave the playlist, if any
+	discardStandby();
+	m_playlistIndex = -1;
+	m_itemPlaying = false;
 
 	// From the MPlayer slave interface documentation:
 	// "Try using something like [the following] to switch to the next file.
 	// It avoids audio playback starting to play the old file for a short time
 	// before switching to the new one.
+	// The pause query is registered like other queries, so its answer isn't
+	// mistaken for the answer to a pending pause query of the user.
 	writeCommand("pausing_keep_force pt_step 1");
-	writeCommand("get_property pause");
+	m_process->queryProperty(s_loadQueryId, "pause", false);
 
 	writeCommand(QString("loadfile '%1'").arg(url));
 }
 
+/*!
+ * \brief Loads an item of the playlist and starts playback
+ * \details
+ * The following items will be played automatically.
+ *
+ * \param index Index of the playlist item
+ * \sa setPlaylist(), loadNext()
+ */
+void QMPwidget::loadItem(int index)
+{
+	if (index < 0 || index >= m_playlist.count()) {
+		return;
+	}
+
+	load(m_playlist[index]);
+	m_playlistIndex = index;
+	emit currentItemChanged(m_playlistIndex);
+}
+
+/*!
+ * \brief Skips to the next item of the playlist
+ * \details
+ * If the next item has been preloaded already, it will be played without
+ * any delay.
+ *
+ * \sa setPlaylist(), loadItem()
+ */
+void QMPwidget::loadNext()
+{
+	int index = nextItem();
+	if (index < 0) {
+		return;
+	}
+
+#ifdef QMP_USE_YUVPIPE
+	// The standby process is paused at the beginning of the item
+	if (m_standby != NULL && m_standbyIndex == index && m_standbyReady) {
+		QMPProcess *process = m_standby;
+		disconnect(process, 0, this, 0);
+		m_standby = NULL;
+		m_standbyIndex = -1;
+
+		adoptProcess(process, false);
+		updateFrameQueue();
+		updateWidgetSize();
+		m_process->pause();
+
+		m_playlistIndex = index;
+		m_itemPlaying = false;
+		emit currentItemChanged(m_playlistIndex);
+		return;
+	}
+#endif
+	loadItem(index);
+}
+
 /*!
  * \brief Resumes playback
  */
@@ -956,6 +2165,7 @@ void QMPwidget::pause()
  */
 void QMPwidget::stop()
 {
+	m_itemPlaying = false;
 	m_process->stop();
 }
 
@@ -974,16 +2184,24 @@ bool QMPwidget::seek(int offset, int whence)
 
 /*!
  * \brief Media playback seeking
+ * \details
+ * Only a single seek request is sent to MPlayer at a time. Requests issued
+ * while MPlayer is still seeking are coalesced: Relative offsets add up,
+ * and other requests replace the pending one.
+ *
+ * While the seek slider is being dragged, MPlayer seeks to the nearest
+ * keyframes only. If the MPlayer executable supports precise seeking (like
+ * mplayer2), the final position is requested again with a precise seek once
+ * the slider is released. MPlayer 1.x always seeks to keyframes, so the
+ * resulting position may differ from the requested one.
  *
  * \param offset Seeking offset in seconds
  * \param whence Seeking mode
  * \returns \p true If the seeking mode is valid
- * \sa tell()
+ * \sa tell(), seekLatency()
  */
 bool QMPwidget::seek(double offset, int whence)
 {
-	m_seekTimer.stop(); // Cancel all current seek requests
-
 	switch (whence) {
 		case RelativeSeek:
 		case PercentageSeek:
@@ -994,11 +2212,32 @@ bool QMPwidget::seek(double offset, int whence)
 	}
 
 	// Schedule seek request
-	m_seekCommand = QString("seek %1 %2").arg(offset).arg(whence);
-	m_seekTimer.start();
+	if (m_seekPending && whence == RelativeSeek && m_seekWhence == RelativeSeek) {
+		m_seekOffset += offset;
+	} else {
+		m_seekOffset = offset;
+		m_seekWhence = whence;
+	}
+	m_seekPending = true;
+	m_seekPrecision = ((m_seekSlider != NULL && m_seekSlider->isSliderDown()) ? -1 : 0);
+	m_seekTimer.start(0);
 	return true;
 }
 
+/*!
+ * \brief Returns the average time MPlayer needs for seeking
+ * \details
+ * The latency is measured from sending a seek command until MPlayer reports
+ * the new position.
+ *
+ * \returns The seek latency in milliseconds, or -1 if unknown
+ * \sa seek()
+ */
+int QMPwidget::seekLatency() const
+{
+	return m_seekLatency;
+}
+
 /*!
  * \brief Toggles full-screen mode
  */
@@ -1036,13 +2275,187 @@ void QMPwidget::toggleFullScreen()
  * For a complete list of commands for MPlayer's slave mode, see
  * http://www.mplayerhq.hu/DOCS/tech/slave.txt .
  *
+ * Commands are queued and written to MPlayer at once when control returns to
+ * the event loop, in the order they have been issued. Only playback control
+ * commands issued by this widget (like pause(), stop() and seeking) are
+ * written before pending property queries.
+ *
  * \param command The command line. A newline character will be added internally.
+ * \sa commandsWritten()
  */
 void QMPwidget::writeCommand(const QString &command)
 {
 	m_process->writeCommand(command);
 }
 
+/*!
+ * \brief Queries the value of a property
+ * \details
+ * This function returns immediately. Once MPlayer has answered, either
+ * propertyReceived() or propertyError() will be emitted with the returned
+ * request id. Multiple queries are sent to MPlayer at once and are answered
+ * in order. The pause state isn't affected by queries.
+ *
+ * For a list of properties, see
+ * http://www.mplayerhq.hu/DOCS/tech/slave.txt .
+ *
+ * \param name Property name, e.g. \p time_pos or \p volume
+ * \returns A positive id identifying this request
+ * \sa setPropertyPolling()
+ */
+int QMPwidget::getProperty(const QString &name)
+{
+	if (++m_lastPropertyId <= 0) {
+		m_lastPropertyId = 1;
+	}
+	m_process->queryProperty(m_lastPropertyId, name);
+	return m_lastPropertyId;
+}
+
+/*!
+ * \brief Queries a set of properties periodically
+ * \details
+ * All properties are queried with a single write in each interval, and
+ * the values are reported by propertyReceived() with a request id of 0. If
+ * MPlayer hasn't answered the previous queries yet, an interval is skipped.
+ * Queries that haven't been answered within two intervals (or two seconds,
+ * whichever is longer) are reported by propertyError().
+ *
+ * \param names Property names. Polling is disabled if the list is empty.
+ * \param interval Polling interval in milliseconds
+ * \sa getProperty()
+ */
+void QMPwidget::setPropertyPolling(const QStringList &names, int interval)
+{
+	m_polledProperties = names;
+	if (names.isEmpty() || interval <= 0) {
+		m_pollTimer.stop();
+	} else {
+		m_pollTimer.start(interval);
+	}
+}
+
+/*!
+ * \brief Returns the number of commands written to MPlayer
+ * \details
+ * The counter is kept for the current MPlayer process. Commands that are still
+ * queued aren't included.
+ *
+ * \returns The number of commands written
+ * \sa commandBytesWritten(), writeCommand()
+ */
+quint64 QMPwidget::commandsWritten() const
+{
+	return m_process->m_commandsWritten;
+}
+
+/*!
+ * \brief Returns the number of bytes written to MPlayer's standard input
+ *
+ * \returns The number of bytes written
+ * \sa commandsWritten()
+ */
+quint64 QMPwidget::commandBytesWritten() const
+{
+	return m_process->m_bytesWritten;
+}
+
+#ifdef QMP_USE_YUVPIPE
+// Summarizes a latency histogram
+static QMPwidget::Latency latency(const QMPLatencyHistogram &histogram)
+{
+	QMPwidget::Latency l;
+	l.samples = histogram.count();
+	l.median = histogram.percentile(0.5);
+	l.p90 = histogram.percentile(0.9);
+	l.p99 = histogram.percentile(0.99);
+	return l;
+}
+#endif
+
+/*!
+ * \brief Returns performance counters of the current MPlayer process
+ * \details
+ * The statistics combine the frame counters, the average number of read
+ * system calls per frame and the stage latencies of
+ * \ref playbackmodes "pipe mode", the A-V drift and dropped frames reported
+ * by MPlayer's status line and the amount of output parsed and commands
+ * written. Latencies are given in microseconds, as the median, 90th and
+ * 99th percentile of all frames since the process has been started:
+ * \li \p readLatency: Reading a frame from the pipe, including waiting for MPlayer
+ * \li \p convertLatency: Scaling and converting a frame to RGB, if done by the CPU
+ * \li \p uploadLatency: Uploading a frame to the GPU (OpenGL only)
+ * \li \p paintLatency: Painting a frame. With OpenGL, this includes waiting for the buffer swap.
+ *
+ * The counters are cheap to maintain and always enabled. Fields that are not
+ * available in the current mode are 0, and \p mplayerDroppedFrames is -1 if
+ * MPlayer didn't report it.
+ *
+ * \returns The current statistics
+ * \sa setStatisticsInterval(), statisticsUpdated()
+ */
+QMPwidget::Statistics QMPwidget::statistics() const
+{
+	Statistics stats;
+
+#ifdef QMP_USE_YUVPIPE
+	if (m_process->m_yuvReader != NULL) {
+		QMPReaderStatistics reader = m_process->m_yuvReader->statistics();
+		stats.framesRead = reader.framesRead;
+		stats.framesConverted = reader.framesConverted;
+		stats.readCallsPerFrame = (reader.framesRead > 0 ? double(reader.readCalls) / reader.framesRead : 0.0);
+		stats.readLatency = latency(reader.read);
+		stats.convertLatency = latency(reader.convert);
+	}
+	const QMPFrameScheduler *scheduler = frameScheduler(m_widget);
+	stats.framesPresented = scheduler->presentedFrames();
+	stats.framesSkipped = scheduler->skippedFrames();
+	stats.framesLate = scheduler->lateFrames();
+	stats.framesDropped = droppedFrames();
+	stats.uploadLatency = latency(scheduler->uploadLatency());
+	stats.paintLatency = latency(scheduler->paintLatency());
+#endif
+
+	stats.audioVideoDelay = m_process->m_playbackStatus.audioVideoDelay;
+	stats.mplayerDroppedFrames = m_process->m_playbackStatus.droppedFrames;
+
+	stats.linesParsed = m_process->m_linesParsed;
+	stats.bytesParsed = m_process->m_bytesParsed;
+	stats.commandsWritten = m_process->m_commandsWritten;
+	stats.commandBytesWritten = m_process->m_bytesWritten;
+	return stats;
+}
+
+/*!
+ * \brief Enables periodic statistics updates
+ * \details
+ * If enabled, statisticsUpdated() will be emitted every \p interval
+ * milliseconds with the current statistics.
+ *
+ * \param interval Update interval in milliseconds. Updates are disabled if
+ * \p interval is 0, which is the default.
+ * \sa statistics()
+ */
+void QMPwidget::setStatisticsInterval(int interval)
+{
+	if (interval <= 0) {
+		m_statisticsTimer.stop();
+	} else {
+		m_statisticsTimer.start(interval);
+	}
+}
+
+/*!
+ * \brief Returns the interval of periodic statistics updates
+ *
+ * \returns The update interval in milliseconds, or 0 if disabled
+ * \sa setStatisticsInterval()
+ */
+int QMPwidget::statisticsInterval() const
+{
+	return (m_statisticsTimer.isActive() ? m_statisticsTimer.interval() : 0);
+}
+
 /*!
  * \brief Mouse double click event handler
  * \details
@@ -1147,6 +2560,204 @@ void QMPwidget::resizeEvent(QResizeEvent *event)
 	updateWidgetSize();
 }
 
+/*!
+ * \brief Signal connection handler
+ * \details
+ * MPlayer output lines are only decoded if the readStandardOutput() and
+ * readStandardError() signals are connected. The same applies to the
+ * playback status for playbackStatusChanged(). If you reimplement this
+ * function, you need to call this handler, too.
+ *
+ * \param signal Normalized signature of the connected signal
+ */
+void QMPwidget::connectNotify(const char *signal)
+{
+	QWidget::connectNotify(signal);
+	updateOutputSignals(signal);
+}
+
+/*!
+ * \brief Signal disconnection handler
+ * \details
+ * If you reimplement this function, you need to call this handler, too.
+ *
+ * \param signal Normalized signature of the disconnected signal
+ * \sa connectNotify()
+ */
+void QMPwidget::disconnectNotify(const char *signal)
+{
+	QWidget::disconnectNotify(signal);
+	updateOutputSignals(signal);
+}
+
+void QMPwidget::updateOutputSignals(const char *signal)
+{
+	if (m_process == NULL) {
+		return;
+	}
+
+	// A null signal means that all connections have been removed
+	if (signal == NULL || qstrcmp(signal, SIGNAL(readStandardOutput(QString))) == 0) {
+		m_process->m_emitStdout = (receivers(SIGNAL(readStandardOutput(QString))) > 0);
+	}
+	if (signal == NULL || qstrcmp(signal, SIGNAL(readStandardError(QString))) == 0) {
+		m_process->m_emitStderr = (receivers(SIGNAL(readStandardError(QString))) > 0);
+	}
+	if (signal == NULL || qstrcmp(signal, SIGNAL(playbackStatusChanged(QMPwidget::PlaybackStatus))) == 0) {
+		m_process->m_emitStatus = (receivers(SIGNAL(playbackStatusChanged(QMPwidget::PlaybackStatus))) > 0);
+	}
+}
+
+void QMPwidget::connectProcess()
+{
+	connect(m_process, SIGNAL(stateChanged(int)), this, SLOT(mpStateChanged(int)));
+	connect(m_process, SIGNAL(streamPositionChanged(double)), this, SLOT(mpStreamPositionChanged(double)));
+	connect(m_process, SIGNAL(error(const QString &)), this, SIGNAL(error(const QString &)));
+	connect(m_process, SIGNAL(playbackStatusChanged(const QMPwidget::PlaybackStatus &)), this, SLOT(mpPlaybackStatusChanged()));
+	connect(m_process, SIGNAL(propertyReceived(int, const QString &, const QString &)), this, SLOT(mpPropertyReceived(int, const QString &, const QString &)));
+	connect(m_process, SIGNAL(propertyError(int, const QString &)), this, SLOT(mpPropertyError(int, const QString &)));
+	connect(m_process, SIGNAL(readStandardOutput(const QString &)), this, SIGNAL(readStandardOutput(const QString &)));
+	connect(m_process, SIGNAL(readStandardError(const QString &)), this, SIGNAL(readStandardError(const QString &)));
+}
+
+#ifdef QMP_USE_YUVPIPE
+// Replaces the current process with one from the pool
+void QMPwidget::adoptProcess(QMPProcess *process, bool notify)
+{
+	QMPProcess *old = m_process;
+	disconnect(old, 0, this, 0);
+	process->copySettings(old);
+	process->setParent(this);
+	m_process = process;
+	connectProcess();
+	updateOutputSignals(NULL);
+	m_seekInFlight = false;
+
+	// This may be called from one of the old process' signals
+	if (old->processState() != QProcess::NotRunning) {
+		old->quitAndDelete();
+	} else {
+		old->deleteLater();
+	}
+
+	// If the process is still starting, the state change will be
+	// reported as usual
+	if (notify && m_process->m_state != NotStartedState) {
+		QMetaObject::invokeMethod(this, "mpStateChanged", Qt::QueuedConnection, Q_ARG(int, m_process->m_state));
+	}
+}
+
+// Hands the frame queue of the current process to the video widget
+void QMPwidget::updateFrameQueue()
+{
+	if (m_process->m_yuvReader == NULL) {
+		return;
+	}
+ #ifdef QT_OPENGL_LIB
+	qobject_cast<QMPOpenGLVideoWidget *>(m_widget)->setFrameQueue(m_process->m_frameQueue);
+ #else
+	qobject_cast<QMPPlainVideoWidget *>(m_widget)->setFrameQueue(m_process->m_frameQueue);
+ #endif
+}
+#endif
+
+// Returns the index of the playlist item following the current one, or -1
+int QMPwidget::nextItem() const
+{
+	if (m_playlistIndex < 0) {
+		return -1;
+	}
+	int index = m_playlistIndex + 1;
+	if (index >= m_playlist.count()) {
+		index = (m_playlistLoop && !m_playlist.isEmpty() ? 0 : -1);
+	}
+	return index;
+}
+
+// Loads the next playlist item in a paused standby process
+void QMPwidget::preloadNextItem()
+{
+#ifdef QMP_USE_YUVPIPE
+	int index = nextItem();
+	if (index < 0 || m_process->m_mode != PipeMode || (m_standby != NULL && m_standbyIndex == index)) {
+		return;
+	}
+	discardStandby();
+
+	QMPProcess *process = QMPProcessPool::instance()->take(m_process->m_mplayerPath, m_process->m_startArgs);
+	if (process != NULL) {
+		process->setParent(this);
+		process->copySettings(m_process);
+	} else {
+		process = new QMPProcess(this);
+		process->m_mode = PipeMode;
+		process->m_mplayerPath = m_process->m_mplayerPath;
+		process->copySettings(m_process);
+		process->start(NULL, m_process->m_startArgs);
+	}
+
+	m_standby = process;
+	m_standbyIndex = index;
+	m_standbyReady = false;
+	connect(m_standby, SIGNAL(stateChanged(int)), this, SLOT(standbyStateChanged(int)));
+	connect(m_standby, SIGNAL(propertyReceived(int, const QString &, const QString &)), this, SLOT(standbyPropertyReceived(int, const QString &, const QString &)));
+	m_standby->writeCommand(QString("pausing loadfile '%1'").arg(m_playlist[index]));
+#endif
+}
+
+void QMPwidget::discardStandby()
+{
+	if (m_standby == NULL) {
+		return;
+	}
+
+	disconnect(m_standby, 0, this, 0);
+	if (m_standby->processState() != QProcess::NotRunning) {
+		m_standby->quitAndDelete();
+	} else {
+		m_standby->deleteLater();
+	}
+	m_standby = NULL;
+	m_standbyIndex = -1;
+	m_standbyReady = false;
+}
+
+void QMPwidget::standbyStateChanged(int state)
+{
+	// The item will be loaded normally if preloading failed
+	if (state == ErrorState || state == NotStartedState) {
+		discardStandby();
+		return;
+	}
+
+	// Once playback has started, "pausing loadfile" should have left the
+	// process paused, but that's not guaranteed in idle mode. Ask MPlayer,
+	// since toggling the pause state blindly might resume playback instead.
+	if (state == PlayingState) {
+		m_standbyReady = false;
+		m_standby->queryProperty(s_standbyQueryId, "pause");
+	} else if (state == PausedState) {
+		m_standbyReady = true;
+	}
+}
+
+void QMPwidget::standbyPropertyReceived(int id, const QString &name, const QString &value)
+{
+	Q_UNUSED(name);
+	if (id != s_standbyQueryId) {
+		return;
+	}
+
+	// The process will report PausedState once the pause command is done.
+	// It has been playing for a moment, so it's rewound as well.
+	if (value == "yes") {
+		m_standbyReady = true;
+	} else {
+		m_standby->pause();
+		m_standby->writeCommand("pausing_keep_force seek 0 2");
+	}
+}
+
 void QMPwidget::updateWidgetSize()
 {
 	if (!m_process->m_mediaInfo.size.isNull()) {
@@ -1162,11 +2773,88 @@ void QMPwidget::updateWidgetSize()
 	}
 }
 
+void QMPwidget::pollProperties()
+{
+	// A lost answer would stop polling otherwise
+	m_process->expireQueries(qMax(2 * m_pollTimer.interval(), 2000));
+	if (m_process->processState() != QProcess::Running || m_process->isStarting() || m_process->hasPendingQuery(0)) {
+		return;
+	}
+	for (int i = 0; i < m_polledProperties.count(); i++) {
+		m_process->queryProperty(0, m_polledProperties[i]);
+	}
+}
+
+void QMPwidget::emitStatistics()
+{
+	emit statisticsUpdated(statistics());
+}
+
 void QMPwidget::delayedSeek()
 {
-	if (!m_seekCommand.isEmpty()) {
-		writeCommand(m_seekCommand);
-		m_seekCommand = QString();
+	if (!m_seekPending) {
+		return;
+	}
+
+	// Wait for the current seek, unless it's overdue
+	if (m_seekInFlight) {
+		int timeout = qMax(4 * m_seekLatency, 2000);
+		int elapsed = int((qmpMicroseconds() - m_seekStart) / 1000);
+		if (elapsed < timeout) {
+			m_seekTimer.start(timeout - elapsed);
+			return;
+		}
+	}
+
+	// The precision is passed explicitly, since precise seeks may be the
+	// default. MPlayer prints the answer to the position query once the seek
+	// is done.
+	QString command = QString("seek %1 %2").arg(m_seekOffset).arg(m_seekWhence);
+	if (m_seekPrecision != 0 && QMPCapabilityCache::instance()->capabilities(m_process->m_mplayerPath).preciseSeek) {
+		command += QString(" %1").arg(m_seekPrecision);
+	}
+	m_process->writeCommand(command, true);
+	m_process->queryProperty(s_seekQueryId, "time_pos");
+	m_seekPending = false;
+	m_seekInFlight = true;
+	m_seekStart = qmpMicroseconds();
+}
+
+// Sends the next seek request once the current one has been finished
+void QMPwidget::seekFinished()
+{
+	int elapsed = int((qmpMicroseconds() - m_seekStart) / 1000);
+	m_seekLatency = (m_seekLatency < 0 ? elapsed : (3 * m_seekLatency + elapsed) / 4);
+	m_seekInFlight = false;
+	m_seekTimer.stop();
+	delayedSeek();
+}
+
+void QMPwidget::seekSliderReleased()
+{
+	// Keyframe seeks have been used while dragging. Without support for
+	// precise seeks, the final position has been requested already.
+	if (QMPCapabilityCache::instance()->capabilities(m_process->m_mplayerPath).preciseSeek) {
+		seek(m_seekSlider->value(), AbsoluteSeek);
+		m_seekPrecision = 1;
+	}
+}
+
+void QMPwidget::mpPropertyReceived(int id, const QString &name, const QString &value)
+{
+	if (id == s_seekQueryId) {
+		seekFinished();
+	} else if (id != s_loadQueryId) {
+		emit propertyReceived(id, name, value);
+	}
+}
+
+void QMPwidget::mpPropertyError(int id, const QString &name)
+{
+	if (id == s_seekQueryId) {
+		seekFinished();
+	} else if (id != s_loadQueryId) {
+		emit propertyError(id, name);
 	}
 }
 
@@ -1182,25 +2870,99 @@ void QMPwidget::mpStateChanged(int state)
 		m_seekSlider->setEnabled(m_process->m_mediaInfo.seekable);
 	}
 
+#ifdef QMP_USE_YUVPIPE
+	// The frame queue is created when the process is actually started
+	if (state == IdleState) {
+		updateFrameQueue();
+	}
+#endif
+
+	// Answers to position queries won't arrive anymore
+	if (state == NotStartedState || state == ErrorState) {
+		m_seekInFlight = false;
+	}
+
 	updateWidgetSize();
 	emit stateChanged(state);
+
+	// Advance the playlist once the current item has finished
+	if (m_playlistIndex >= 0) {
+		if (state == PlayingState && !m_itemPlaying) {
+			m_itemPlaying = true;
+			preloadNextItem();
+		} else if (state == IdleState && m_itemPlaying) {
+			// In pipe mode, this happens as soon as MPlayer has closed the
+			// YUV pipe at the end of the item
+			m_itemPlaying = false;
+			loadNext();
+		} else if (state == ErrorState || state == NotStartedState) {
+			m_itemPlaying = false;
+		}
+	}
 }
 
 void QMPwidget::mpStreamPositionChanged(double position)
 {
-	if (m_seekSlider != NULL && m_seekCommand.isEmpty() && m_seekSlider->value() != qRound(position)) {
-		m_seekSlider->disconnect(this);
-		m_seekSlider->setValue(qRound(position));
-		connect(m_seekSlider, SIGNAL(valueChanged(int)), this, SLOT(seek(int)));
+	Q_UNUSED(position);
+	m_positionPending = true;
+	scheduleNotification();
+}
+
+void QMPwidget::mpPlaybackStatusChanged()
+{
+	m_statusPending = true;
+	scheduleNotification();
+}
+
+// Delivers pending notifications now or as soon as the notification rate
+// permits. Notifications arriving in between are coalesced.
+void QMPwidget::scheduleNotification()
+{
+	int rate = (m_notificationRate >= 0 ? m_notificationRate : s_globalNotificationRate);
+	if (rate <= 0) {
+		notify();
+		return;
+	}
+	if (m_notificationTimer.isActive()) {
+		return;
+	}
+
+	int interval = 1000 / rate;
+	int elapsed = (m_lastNotification.isNull() ? interval : m_lastNotification.elapsed());
+	if (elapsed >= interval || elapsed < 0) {
+		notify();
+	} else {
+		m_notificationTimer.start(interval - elapsed);
+	}
+}
+
+void QMPwidget::notify()
+{
+	m_lastNotification.start();
+
+	if (m_positionPending) {
+		m_positionPending = false;
+		double position = m_process->m_streamPosition;
+		if (m_seekSlider != NULL && !m_seekPending && !m_seekInFlight && !m_seekSlider->isSliderDown() && m_seekSlider->value() != qRound(position)) {
+			bool blocked = m_seekSlider->blockSignals(true);
+			m_seekSlider->setValue(qRound(position));
+			m_seekSlider->blockSignals(blocked);
+		}
+		emit streamPositionChanged(position);
+	}
+
+	if (m_statusPending) {
+		m_statusPending = false;
+		emit playbackStatusChanged(m_process->m_playbackStatus);
 	}
 }
 
 void QMPwidget::mpVolumeChanged(int volume)
 {
 	if (m_volumeSlider != NULL) {
-		m_volumeSlider->disconnect(this);
+		bool blocked = m_volumeSlider->blockSignals(true);
 		m_volumeSlider->setValue(volume);
-		connect(m_seekSlider, SIGNAL(valueChanged(int)), this, SLOT(setVolume(int)));
+		m_volumeSlider->blockSignals(blocked);
 	}
 }
 
@@ -1333,6 +3095,35 @@ int main(int argc, char **argv)
  * </table>
  */
 
+/*!
+ * \enum QMPwidget::FrameDropPolicy
+ * \brief Frame drop policies
+ * \details
+ * This enumeration describes what happens to frames in \ref playbackmodes "pipe mode"
+ * if the frame queue is full, i.e. if frames are decoded faster than they can
+ * be displayed.
+ *
+ * <table>
+ *  <tr><th>Constant</th><th>Value</th><th>Description</th></tr>
+ *  <tr>
+ *   <td>\p QMPwidget::DropOldestFrame</td>
+ *   <td>\p 0</td>
+ *   <td>The oldest queued frame is replaced by the new one</td>
+ *  </tr>
+ *  <tr>
+ *   <td>\p QMPwidget::DropNewestFrame</td>
+ *   <td>\p 1</td>
+ *   <td>The new frame is dropped without being converted</td>
+ *  </tr>
+ *  <tr>
+ *   <td>\p QMPwidget::BlockReader</td>
+ *   <td>\p 2</td>
+ *   <td>The reader waits until a frame has been displayed. MPlayer will
+ *       block on writing to the pipe, too.</td>
+ *  </tr>
+ * </table>
+ */
+
 /*!
  * \enum QMPwidget::SeekMode
  * \brief Seeking modes
@@ -1377,6 +3168,68 @@ int main(int argc, char **argv)
  * \param reason Textual error description (may be empty)
  */
 
+/*!
+ * \fn void QMPwidget::streamPositionChanged(double position)
+ * \brief Emitted if the stream position has changed
+ * \details
+ * The rate of this signal can be limited using setNotificationRate().
+ *
+ * \param position The new stream position in seconds
+ * \sa tell()
+ */
+
+/*!
+ * \fn void QMPwidget::playbackStatusChanged(const QMPwidget::PlaybackStatus &status)
+ * \brief Emitted if MPlayer printed a new status line
+ * \details
+ * The status contains the audio and video positions, the A-V delay, the
+ * frame counters, the CPU usage of the codecs and the video output (in
+ * percent), the postprocessing level and the cache fill (in percent). The
+ * rate of this signal can be limited using setNotificationRate().
+ *
+ * \param status The new playback status
+ * \sa playbackStatus()
+ */
+
+/*!
+ * \fn void QMPwidget::currentItemChanged(int index)
+ * \brief Emitted if another playlist item is played
+ *
+ * \param index Index of the new playlist item
+ * \sa setPlaylist(), currentItem()
+ */
+
+/*!
+ * \fn void QMPwidget::propertyReceived(int id, const QString &name, const QString &value)
+ * \brief Emitted if MPlayer answered a property query
+ *
+ * \param id Request id as returned by getProperty(), or 0 for polled properties
+ * \param name Property name
+ * \param value Property value as printed by MPlayer
+ * \sa setPropertyPolling()
+ */
+
+/*!
+ * \fn void QMPwidget::propertyError(int id, const QString &name)
+ * \brief Emitted if a property couldn't be queried
+ * \details
+ * This happens if the property is unknown or not available, e.g. if no
+ * file is being played.
+ *
+ * \param id Request id as returned by getProperty(), or 0 for polled properties
+ * \param name Property name
+ */
+
+/*!
+ * \fn void QMPwidget::statisticsUpdated(const QMPwidget::Statistics &statistics)
+ * \brief Emitted periodically with the current statistics
+ * \details
+ * This signal is only emitted if enabled using setStatisticsInterval().
+ *
+ * \param statistics The current statistics
+ * \sa statistics()
+ */
+
 /*!
  * \fn void QMPwidget::readStandardOutput(const QString &line)
  * \brief Signal for reading MPlayer's standard output
@@ -22,14 +22,16 @@
 
 
 #include <QHash>
+#include <QMetaType>
 #include <QPointer>
+#include <QStringList>
+#include <QTime>
 #include <QTimer>
 #include <QWidget>
 
 class QAbstractSlider;
 class QImage;
 class QProcess;
-class QStringList;
 
 class QMPProcess;
 
@@ -76,6 +78,59 @@ class QMPwidget : public QWidget
 			MediaInfo();
 		};
 
+		struct PlaybackStatus {
+			double audioPosition;
+			double videoPosition;
+			double audioVideoDelay;
+			double totalCorrection;
+
+			int playedFrames;
+			int decodedFrames;
+			int droppedFrames;
+
+			double videoCodecUsage;
+			double videoOutputUsage;
+			double audioCodecUsage;
+			int postprocessingLevel;
+			int cacheFill;
+
+			PlaybackStatus();
+		};
+
+		struct Latency {
+			quint64 samples;
+			double median;
+			double p90;
+			double p99;
+
+			Latency();
+		};
+
+		struct Statistics {
+			quint64 framesRead;
+			quint64 framesConverted;
+			quint64 framesPresented;
+			quint64 framesDropped;
+			quint64 framesSkipped;
+			quint64 framesLate;
+			double readCallsPerFrame;
+
+			Latency readLatency;
+			Latency convertLatency;
+			Latency uploadLatency;
+			Latency paintLatency;
+
+			double audioVideoDelay;
+			int mplayerDroppedFrames;
+
+			quint64 linesParsed;
+			quint64 bytesParsed;
+			quint64 commandsWritten;
+			quint64 commandBytesWritten;
+
+			Statistics();
+		};
+
 		enum Mode {
 			EmbeddedMode = 0,
 			PipeMode
@@ -87,6 +142,12 @@ class QMPwidget : public QWidget
 			AbsoluteSeek
 		};
 
+		enum FrameDropPolicy {
+			DropOldestFrame = 0,
+			DropNewestFrame,
+			BlockReader
+		};
+
 	public:
 		QMPwidget(QWidget *parent = 0);
 		virtual ~QMPwidget();
@@ -99,12 +160,59 @@ class QMPwidget : public QWidget
 		void setMode(Mode mode);
 		Mode mode() const;
 
+		void setConversionThreads(int threads);
+		int conversionThreads() const;
+
+		void setScalingMode(Qt::TransformationMode mode);
+		Qt::TransformationMode scalingMode() const;
+
+		void setFrameQueueSize(int size);
+		int frameQueueSize() const;
+		void setFrameDropPolicy(FrameDropPolicy policy);
+		FrameDropPolicy frameDropPolicy() const;
+		quint64 droppedFrames() const;
+		void setRefreshRate(double rate);
+		double refreshRate() const;
+		quint64 presentedFrames() const;
+		quint64 skippedFrames() const;
+		quint64 lateFrames() const;
+		PlaybackStatus playbackStatus() const;
+		quint64 commandsWritten() const;
+		quint64 commandBytesWritten() const;
+
+		Statistics statistics() const;
+		void setStatisticsInterval(int interval);
+		int statisticsInterval() const;
+
+		int seekLatency() const;
+
+		int getProperty(const QString &name);
+		void setPropertyPolling(const QStringList &names, int interval);
+
+		void setNotificationRate(int rate);
+		int notificationRate() const;
+		static void setGlobalNotificationRate(int rate);
+		static int globalNotificationRate();
+
+		void setPipeBufferSize(int size);
+		int pipeBufferSize() const;
+
 		void setVideoOutput(const QString &output);
 		QString videoOutput() const;
 
 		void setMPlayerPath(const QString &path);
 		QString mplayerPath() const;
 		QString mplayerVersion();
+		QStringList supportedVideoOutputs();
+		static void setCapabilityCachePersistent(bool persistent);
+		static bool saveTrace(const QString &fileName);
+
+		static void setProcessPool(int size, const QStringList &args = QStringList(), const QString &mplayerPath = QString("mplayer"));
+		static int processPoolSize();
+
+		void setPlaylist(const QStringList &urls, bool loop = false);
+		QStringList playlist() const;
+		int currentItem() const;
 
 		void setSeekSlider(QAbstractSlider *slider);
 		void setVolumeSlider(QAbstractSlider *slider);
@@ -116,6 +224,8 @@ class QMPwidget : public QWidget
 	public slots:
 		void start(const QStringList &args = QStringList());
 		void load(const QString &url);
+		void loadItem(int index);
+		void loadNext();
 		void play();
 		void pause();
 		void stop();
@@ -130,21 +240,47 @@ class QMPwidget : public QWidget
 		virtual void mouseDoubleClickEvent(QMouseEvent *event);
 		virtual void keyPressEvent(QKeyEvent *event);
 		virtual void resizeEvent(QResizeEvent *event);
+		virtual void connectNotify(const char *signal);
+		virtual void disconnectNotify(const char *signal);
 
 	private:
 		void updateWidgetSize();
+		void updateOutputSignals(const char *signal);
+		void connectProcess();
+		void adoptProcess(QMPProcess *process, bool notify = true);
+		void updateFrameQueue();
+		int nextItem() const;
+		void preloadNextItem();
+		void discardStandby();
+		void scheduleNotification();
+		void seekFinished();
 
 	private slots:
 		void setVolume(int volume);
 
 		void mpStateChanged(int state);
 		void mpStreamPositionChanged(double position);
+		void mpPlaybackStatusChanged();
+		void notify();
 		void mpVolumeChanged(int volume);
 		void delayedSeek();
+		void seekSliderReleased();
+		void mpPropertyReceived(int id, const QString &name, const QString &value);
+		void mpPropertyError(int id, const QString &name);
+		void pollProperties();
+		void standbyStateChanged(int state);
+		void standbyPropertyReceived(int id, const QString &name, const QString &value);
+		void emitStatistics();
 
 	signals:
 		void stateChanged(int state);
 		void error(const QString &reason);
+		void streamPositionChanged(double position);
+		void playbackStatusChanged(const QMPwidget::PlaybackStatus &status);
+		void currentItemChanged(int index);
+		void propertyReceived(int id, const QString &name, const QString &value);
+		void propertyError(int id, const QString &name);
+		void statisticsUpdated(const QMPwidget::Statistics &statistics);
 
 		void readStandardOutput(const QString &line);
 		void readStandardError(const QString &line);
@@ -158,8 +294,37 @@ class QMPwidget : public QWidget
 		QRect m_geometry;
 
 		QTimer m_seekTimer;
-		QString m_seekCommand;
+		bool m_seekPending;
+		double m_seekOffset;
+		int m_seekWhence;
+		int m_seekPrecision; // -1: keyframes, 0: default, 1: precise
+		bool m_seekInFlight;
+		qint64 m_seekStart;
+		int m_seekLatency;
+
+		int m_notificationRate;
+		QTimer m_notificationTimer;
+		QTime m_lastNotification;
+		bool m_positionPending;
+		bool m_statusPending;
+
+		QStringList m_playlist;
+		bool m_playlistLoop;
+		int m_playlistIndex;
+		bool m_itemPlaying;
+		QMPProcess *m_standby;
+		int m_standbyIndex;
+		bool m_standbyReady;
+
+		int m_lastPropertyId;
+		QStringList m_polledProperties;
+		QTimer m_pollTimer;
+
+		QTimer m_statisticsTimer;
 };
 
+Q_DECLARE_METATYPE(QMPwidget::PlaybackStatus)
+Q_DECLARE_METATYPE(QMPwidget::Statistics)
+
 
 #endif // QMPWIDGET_H_
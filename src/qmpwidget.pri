@@ -4,12 +4,27 @@
 #
 
 HEADERS += \
-	qmpwidget.h
+	qmpwidget.h \
+	qmpcapabilities.h \
+	qmpoutputparser.h \
+	qmpstatistics.h \
+	qmptrace.h
 
 SOURCES += \
 	qmpwidget.cpp
 
+contains(QT, opengl): {
+HEADERS += qmpopenglwidget.h
+}
+
 !win32:pipemode: {
 DEFINES += QMP_USE_YUVPIPE
-HEADERS += qmpyuvreader.h
+HEADERS += qmpyuvreader.h qmpyuvconverter.h qmpframequeue.h
+}
+
+# clock_gettime() is in librt for older glibc versions
+unix:!macx: LIBS += -lrt
+
+tracing: {
+DEFINES += QMP_USE_TRACING
 }
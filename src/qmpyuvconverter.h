@@ -0,0 +1,774 @@
+/*
+ *  qmpwidget - A Qt widget for embedding MPlayer
+ *  Copyright (C) 2010 by Jonas Gehring
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef QMPYUVCONVERTER_H_
+#define QMPYUVCONVERTER_H_
+
+
+#include <QImage>
+#include <QList>
+#include <QRunnable>
+#include <QSemaphore>
+#include <QThreadPool>
+#include <QVarLengthArray>
+#include <QVector>
+#include <QtGlobal>
+
+// SIMD kernels are compiled with per-function target attributes and selected
+// at runtime, so the library itself doesn't need to be built with -mavx2
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__)) && !defined(QMP_NO_SIMD) \
+	&& (defined(__clang__) || (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))
+ #define QMP_YUV_SIMD
+ #include <immintrin.h>
+#endif
+
+#include "qmptrace.h"
+
+
+// Internal YCbCr to RGB converter
+class QMPYuvConverter
+{
+	public:
+		// Supported chroma subsampling layouts
+		enum Layout {
+			Layout420 = 0,
+			Layout422,
+			Layout444
+		};
+
+		// Constructor
+		QMPYuvConverter()
+		{
+			initTables();
+			selectKernels();
+		}
+
+		// Converts a single row of 4:4:4 YCbCr data to ARGB32 pixels
+		inline void convertRow(const uchar *yptr, const uchar *cbptr, const uchar *crptr, QRgb *dptr, int width) const
+		{
+			m_rowKernel(this, yptr, cbptr, crptr, dptr, width);
+		}
+
+		// Converts 4:2:0 YCbCr data to ARGB32 pixels. The chroma planes are
+		// upsampled on the fly, a row pair at a time, so only a few lines of
+		// full-resolution chroma data exist at any time. If a row range is
+		// given, only the rows [first, last) will be converted; \p first needs
+		// to be even. This is thread-safe for disjoint row ranges.
+		void convert420(unsigned char *planes[], uchar *dest, int bytesPerLine, int width, int height, int first = 0, int last = -1) const
+		{
+			const int cwidth = (width + 1) / 2;
+			const int cheight = (height + 1) / 2;
+			if (last < 0 || last > height) {
+				last = height;
+			}
+			Q_ASSERT((first & 1) == 0);
+
+			QVarLengthArray<uchar, 4 * 2048> lines(4 * 2 * cwidth);
+			uchar *cbtop = lines.data();
+			uchar *crtop = cbtop + 2 * cwidth;
+			uchar *cbbottom = crtop + 2 * cwidth;
+			uchar *crbottom = cbbottom + 2 * cwidth;
+
+			for (int y = first; y < last; y += 2) {
+				const int r = y / 2;
+				const uchar *cbrow = planes[1] + r * cwidth;
+				const uchar *crrow = planes[2] + r * cwidth;
+
+				m_upsampleKernel(cbrow, (r > 0 ? cbrow - cwidth : NULL), cbtop, cwidth);
+				m_upsampleKernel(crrow, (r > 0 ? crrow - cwidth : NULL), crtop, cwidth);
+				convertRow(planes[0] + y * width, cbtop, crtop, (QRgb *)(dest + y * bytesPerLine), width);
+
+				if (y + 1 < last) {
+					m_upsampleKernel(cbrow, (r + 1 < cheight ? cbrow + cwidth : NULL), cbbottom, cwidth);
+					m_upsampleKernel(crrow, (r + 1 < cheight ? crrow + cwidth : NULL), crbottom, cwidth);
+					convertRow(planes[0] + (y + 1) * width, cbbottom, crbottom, (QRgb *)(dest + (y + 1) * bytesPerLine), width);
+				}
+			}
+		}
+
+		// Converts 4:2:2 YCbCr data to ARGB32 pixels. The chroma samples are
+		// co-sited with the even luma samples, so only every second pixel
+		// needs to be interpolated.
+		void convert422(unsigned char *planes[], uchar *dest, int bytesPerLine, int width, int height, int first = 0, int last = -1) const
+		{
+			const int cwidth = (width + 1) / 2;
+			if (last < 0 || last > height) {
+				last = height;
+			}
+
+			QVarLengthArray<uchar, 2 * 2048> lines(2 * 2 * cwidth);
+			uchar *cbline = lines.data();
+			uchar *crline = cbline + 2 * cwidth;
+
+			for (int y = first; y < last; y++) {
+				m_upsample422Kernel(planes[1] + y * cwidth, cbline, cwidth);
+				m_upsample422Kernel(planes[2] + y * cwidth, crline, cwidth);
+				convertRow(planes[0] + y * width, cbline, crline, (QRgb *)(dest + y * bytesPerLine), width);
+			}
+		}
+
+		// Converts 4:4:4 YCbCr data to ARGB32 pixels. No upsampling is needed
+		// at all, so the row kernel works on the planes directly.
+		void convert444(unsigned char *planes[], uchar *dest, int bytesPerLine, int width, int height, int first = 0, int last = -1) const
+		{
+			if (last < 0 || last > height) {
+				last = height;
+			}
+			for (int y = first; y < last; y++) {
+				const int offset = y * width;
+				convertRow(planes[0] + offset, planes[1] + offset, planes[2] + offset, (QRgb *)(dest + y * bytesPerLine), width);
+			}
+		}
+
+		// Converts YCbCr data of the given layout to ARGB32 pixels
+		void convert(Layout layout, unsigned char *planes[], uchar *dest, int bytesPerLine, int width, int height, int first = 0, int last = -1) const
+		{
+			switch (layout) {
+				case Layout422: convert422(planes, dest, bytesPerLine, width, height, first, last); break;
+				case Layout444: convert444(planes, dest, bytesPerLine, width, height, first, last); break;
+				default: convert420(planes, dest, bytesPerLine, width, height, first, last); break;
+			}
+		}
+
+		// Returns the name of the row kernel in use
+		const char *kernelName() const
+		{
+			return m_kernelName;
+		}
+
+		// Row kernels
+		enum Kernel {
+			TablesKernel = 0,
+			Sse2Kernel,
+			Avx2Kernel
+		};
+
+		// Selects a specific kernel, e.g. for comparing kernels in tests.
+		// Returns false if the kernel isn't supported by the CPU or hasn't
+		// been compiled in.
+		bool setKernel(Kernel kernel)
+		{
+			switch (kernel) {
+				case TablesKernel:
+					m_rowKernel = &convertRowTables;
+					m_upsampleKernel = &upsampleRow420;
+					m_upsample422Kernel = &upsampleRow422;
+					m_kernelName = "tables";
+					return true;
+#ifdef QMP_YUV_SIMD
+				case Sse2Kernel:
+					__builtin_cpu_init();
+					if (!__builtin_cpu_supports("sse2")) {
+						return false;
+					}
+					m_rowKernel = &convertRowSse2;
+					m_upsampleKernel = &upsampleRow420Sse2;
+					m_upsample422Kernel = &upsampleRow422Sse2;
+					m_kernelName = "sse2";
+					return true;
+				case Avx2Kernel:
+					__builtin_cpu_init();
+					if (!__builtin_cpu_supports("avx2")) {
+						return false;
+					}
+					m_rowKernel = &convertRowAvx2;
+					m_upsampleKernel = &upsampleRow420Sse2;
+					m_upsample422Kernel = &upsampleRow422Sse2;
+					m_kernelName = "avx2";
+					return true;
+#endif
+				default:
+					return false;
+			}
+		}
+
+	private:
+		typedef void (*RowKernel)(const QMPYuvConverter *c, const uchar *yptr, const uchar *cbptr, const uchar *crptr, QRgb *dptr, int width);
+		typedef void (*UpsampleKernel)(const uchar *cur, const uchar *nb, uchar *dest, int cwidth);
+		typedef void (*Upsample422Kernel)(const uchar *src, uchar *dest, int cwidth);
+
+		// Chooses the fastest row kernel supported by the CPU. Setting
+		// QMP_NO_SIMD in the environment forces the reference implementation.
+		void selectKernels()
+		{
+			setKernel(TablesKernel);
+#ifdef QMP_YUV_SIMD
+			if (!qgetenv("QMP_NO_SIMD").isEmpty()) {
+				return;
+			}
+			if (!setKernel(Avx2Kernel)) {
+				setKernel(Sse2Kernel);
+			}
+#endif
+		}
+
+		// Upsamples one row of 4:2:0 chroma data horizontally and vertically.
+		// \p nb is the vertically adjacent chroma row (the previous one for
+		// even output rows and the next one for odd output rows), or NULL at
+		// the image borders. The results are identical to the in-place 420 to
+		// 444 supersampling from mjpegtools, which uses the center sample for
+		// any neighbor outside of the image.
+		static void upsampleRow420(const uchar *cur, const uchar *nb, uchar *dest, int cwidth)
+		{
+			int c = 0;
+			if (nb != NULL) {
+				upsampleSample420(cur, nb, dest, 0, cwidth);
+				for (c = 1; c < cwidth - 1; c++) {
+					dest[2*c] = (nb[c-1] + 3*(nb[c] + cur[c-1]) + 9*cur[c] + 8) >> 4;
+					dest[2*c+1] = (nb[c+1] + 3*(nb[c] + cur[c+1]) + 9*cur[c] + 8) >> 4;
+				}
+			} else {
+				upsampleSample420(cur, nb, dest, 0, cwidth);
+				for (c = 1; c < cwidth - 1; c++) {
+					dest[2*c] = (3*cur[c-1] + 13*cur[c] + 8) >> 4;
+					dest[2*c+1] = (3*cur[c+1] + 13*cur[c] + 8) >> 4;
+				}
+			}
+			if (cwidth > 1) {
+				upsampleSample420(cur, nb, dest, cwidth - 1, cwidth);
+			}
+		}
+
+		// Upsamples a single chroma sample, including all border checks
+		static inline void upsampleSample420(const uchar *cur, const uchar *nb, uchar *dest, int c, int cwidth)
+		{
+			const int c00 = cur[c];
+			const int v = (nb != NULL ? nb[c] : c00);
+			const int hl = (c > 0 ? cur[c-1] : c00);
+			const int dl = (c > 0 && nb != NULL ? nb[c-1] : c00);
+			const int hr = (c < cwidth - 1 ? cur[c+1] : c00);
+			const int dr = (c < cwidth - 1 && nb != NULL ? nb[c+1] : c00);
+			dest[2*c] = (dl + 3*(v + hl) + 9*c00 + 8) >> 4;
+			dest[2*c+1] = (dr + 3*(v + hr) + 9*c00 + 8) >> 4;
+		}
+
+		// Upsamples one row of co-sited 4:2:2 chroma data horizontally. Odd
+		// output samples are the rounded average of their neighbors, and the
+		// last sample is replicated at the right border.
+		static void upsampleRow422(const uchar *src, uchar *dest, int cwidth)
+		{
+			for (int c = 0; c < cwidth - 1; c++) {
+				dest[2*c] = src[c];
+				dest[2*c+1] = (src[c] + src[c+1] + 1) >> 1;
+			}
+			dest[2*cwidth-2] = src[cwidth-1];
+			dest[2*cwidth-1] = src[cwidth-1];
+		}
+
+		// Reference implementation, partly from mjpegtools
+		static void convertRowTables(const QMPYuvConverter *c, const uchar *yptr, const uchar *cbptr, const uchar *crptr, QRgb *dptr, int width)
+		{
+			for (int x = 0; x < width; x++) {
+				*dptr = qRgb(qBound(0, (c->RGB_Y[*yptr] + c->R_Cr[*crptr]) >> 18, 255),
+					qBound(0, (c->RGB_Y[*yptr] + c->G_Cb[*cbptr]+ c->G_Cr[*crptr]) >> 18, 255),
+					qBound(0, (c->RGB_Y[*yptr] + c->B_Cb[*cbptr]) >> 18, 255));
+				++yptr;
+				++cbptr;
+				++crptr;
+				++dptr;
+			}
+		}
+
+#ifdef QMP_YUV_SIMD
+		// Clamps and interleaves eight pixels worth of 32-bit R, G and B sums
+		// (before the final shift) into ARGB32 and stores them. Saturating packs
+		// are exactly equivalent to the qBound() calls of the reference code.
+		__attribute__((target("sse2")))
+		static inline void storePixelsSse2(__m128i r0, __m128i r1, __m128i g0, __m128i g1, __m128i b0, __m128i b1, QRgb *dptr)
+		{
+			const __m128i alpha = _mm_set1_epi8((char)0xff);
+			__m128i r = _mm_packs_epi32(_mm_srai_epi32(r0, 18), _mm_srai_epi32(r1, 18));
+			__m128i g = _mm_packs_epi32(_mm_srai_epi32(g0, 18), _mm_srai_epi32(g1, 18));
+			__m128i b = _mm_packs_epi32(_mm_srai_epi32(b0, 18), _mm_srai_epi32(b1, 18));
+			r = _mm_packus_epi16(r, r);
+			g = _mm_packus_epi16(g, g);
+			b = _mm_packus_epi16(b, b);
+
+			// QRgb is stored as B, G, R, A in memory
+			__m128i bg = _mm_unpacklo_epi8(b, g);
+			__m128i ra = _mm_unpacklo_epi8(r, alpha);
+			_mm_storeu_si128((__m128i *)dptr, _mm_unpacklo_epi16(bg, ra));
+			_mm_storeu_si128((__m128i *)(dptr + 4), _mm_unpackhi_epi16(bg, ra));
+		}
+
+		// SSE2 kernel: The table lookups stay scalar (there's no gather), but
+		// summing, shifting, clamping and packing is done eight pixels at a time
+		__attribute__((target("sse2")))
+		static void convertRowSse2(const QMPYuvConverter *c, const uchar *yptr, const uchar *cbptr, const uchar *crptr, QRgb *dptr, int width)
+		{
+			int x = 0;
+			for (; x + 8 <= width; x += 8) {
+				__m128i y0 = _mm_setr_epi32(c->RGB_Y[yptr[0]], c->RGB_Y[yptr[1]], c->RGB_Y[yptr[2]], c->RGB_Y[yptr[3]]);
+				__m128i y1 = _mm_setr_epi32(c->RGB_Y[yptr[4]], c->RGB_Y[yptr[5]], c->RGB_Y[yptr[6]], c->RGB_Y[yptr[7]]);
+				__m128i r0 = _mm_setr_epi32(c->R_Cr[crptr[0]], c->R_Cr[crptr[1]], c->R_Cr[crptr[2]], c->R_Cr[crptr[3]]);
+				__m128i r1 = _mm_setr_epi32(c->R_Cr[crptr[4]], c->R_Cr[crptr[5]], c->R_Cr[crptr[6]], c->R_Cr[crptr[7]]);
+				__m128i g0 = _mm_add_epi32(
+					_mm_setr_epi32(c->G_Cb[cbptr[0]], c->G_Cb[cbptr[1]], c->G_Cb[cbptr[2]], c->G_Cb[cbptr[3]]),
+					_mm_setr_epi32(c->G_Cr[crptr[0]], c->G_Cr[crptr[1]], c->G_Cr[crptr[2]], c->G_Cr[crptr[3]]));
+				__m128i g1 = _mm_add_epi32(
+					_mm_setr_epi32(c->G_Cb[cbptr[4]], c->G_Cb[cbptr[5]], c->G_Cb[cbptr[6]], c->G_Cb[cbptr[7]]),
+					_mm_setr_epi32(c->G_Cr[crptr[4]], c->G_Cr[crptr[5]], c->G_Cr[crptr[6]], c->G_Cr[crptr[7]]));
+				__m128i b0 = _mm_setr_epi32(c->B_Cb[cbptr[0]], c->B_Cb[cbptr[1]], c->B_Cb[cbptr[2]], c->B_Cb[cbptr[3]]);
+				__m128i b1 = _mm_setr_epi32(c->B_Cb[cbptr[4]], c->B_Cb[cbptr[5]], c->B_Cb[cbptr[6]], c->B_Cb[cbptr[7]]);
+
+				storePixelsSse2(_mm_add_epi32(y0, r0), _mm_add_epi32(y1, r1),
+					_mm_add_epi32(y0, g0), _mm_add_epi32(y1, g1),
+					_mm_add_epi32(y0, b0), _mm_add_epi32(y1, b1), dptr);
+
+				yptr += 8;
+				cbptr += 8;
+				crptr += 8;
+				dptr += 8;
+			}
+			convertRowTables(c, yptr, cbptr, crptr, dptr, width - x);
+		}
+
+		// SSE2 version of upsampleRow420(). Away from the borders, the filter is
+		// separable: Each output sample is 3*A[c] + A[c-1 or c+1], with
+		// A[c] = 3*cur[c] + nb[c].
+		__attribute__((target("sse2")))
+		static void upsampleRow420Sse2(const uchar *cur, const uchar *nb, uchar *dest, int cwidth)
+		{
+			if (nb == NULL || cwidth < 10) {
+				upsampleRow420(cur, nb, dest, cwidth);
+				return;
+			}
+
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i three = _mm_set1_epi16(3);
+			const __m128i eight = _mm_set1_epi16(8);
+			upsampleSample420(cur, nb, dest, 0, cwidth);
+			int c = 1;
+			for (; c + 8 <= cwidth - 1; c += 8) {
+				__m128i am = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(cur + c - 1)), zero), three),
+					_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(nb + c - 1)), zero));
+				__m128i a0 = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(cur + c)), zero), three),
+					_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(nb + c)), zero));
+				__m128i ap = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(cur + c + 1)), zero), three),
+					_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(nb + c + 1)), zero));
+				a0 = _mm_add_epi16(_mm_mullo_epi16(a0, three), eight);
+				__m128i left = _mm_srli_epi16(_mm_add_epi16(a0, am), 4);
+				__m128i right = _mm_srli_epi16(_mm_add_epi16(a0, ap), 4);
+				left = _mm_packus_epi16(left, left);
+				right = _mm_packus_epi16(right, right);
+				_mm_storeu_si128((__m128i *)(dest + 2*c), _mm_unpacklo_epi8(left, right));
+			}
+			for (; c < cwidth - 1; c++) {
+				dest[2*c] = (nb[c-1] + 3*(nb[c] + cur[c-1]) + 9*cur[c] + 8) >> 4;
+				dest[2*c+1] = (nb[c+1] + 3*(nb[c] + cur[c+1]) + 9*cur[c] + 8) >> 4;
+			}
+			upsampleSample420(cur, nb, dest, cwidth - 1, cwidth);
+		}
+
+		// SSE2 version of upsampleRow422(). The rounding of _mm_avg_epu8() is
+		// identical to the reference code.
+		__attribute__((target("sse2")))
+		static void upsampleRow422Sse2(const uchar *src, uchar *dest, int cwidth)
+		{
+			int c = 0;
+			for (; c + 17 <= cwidth; c += 16) {
+				__m128i cur = _mm_loadu_si128((const __m128i *)(src + c));
+				__m128i avg = _mm_avg_epu8(cur, _mm_loadu_si128((const __m128i *)(src + c + 1)));
+				_mm_storeu_si128((__m128i *)(dest + 2*c), _mm_unpacklo_epi8(cur, avg));
+				_mm_storeu_si128((__m128i *)(dest + 2*c + 16), _mm_unpackhi_epi8(cur, avg));
+			}
+			upsampleRow422(src + c, dest + 2*c, cwidth - c);
+		}
+
+		// AVX2 kernel: Uses gathers for the table lookups, 16 pixels at a time
+		__attribute__((target("avx2")))
+		static void convertRowAvx2(const QMPYuvConverter *c, const uchar *yptr, const uchar *cbptr, const uchar *crptr, QRgb *dptr, int width)
+		{
+			const __m256i alpha = _mm256_set1_epi8((char)0xff);
+			int x = 0;
+			for (; x + 16 <= width; x += 16) {
+				__m256i yi0 = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)yptr));
+				__m256i yi1 = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(yptr + 8)));
+				__m256i cbi0 = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)cbptr));
+				__m256i cbi1 = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(cbptr + 8)));
+				__m256i cri0 = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)crptr));
+				__m256i cri1 = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(crptr + 8)));
+
+				__m256i y0 = _mm256_i32gather_epi32(c->RGB_Y, yi0, 4);
+				__m256i y1 = _mm256_i32gather_epi32(c->RGB_Y, yi1, 4);
+				__m256i r0 = _mm256_add_epi32(y0, _mm256_i32gather_epi32(c->R_Cr, cri0, 4));
+				__m256i r1 = _mm256_add_epi32(y1, _mm256_i32gather_epi32(c->R_Cr, cri1, 4));
+				__m256i g0 = _mm256_add_epi32(y0, _mm256_add_epi32(_mm256_i32gather_epi32(c->G_Cb, cbi0, 4), _mm256_i32gather_epi32(c->G_Cr, cri0, 4)));
+				__m256i g1 = _mm256_add_epi32(y1, _mm256_add_epi32(_mm256_i32gather_epi32(c->G_Cb, cbi1, 4), _mm256_i32gather_epi32(c->G_Cr, cri1, 4)));
+				__m256i b0 = _mm256_add_epi32(y0, _mm256_i32gather_epi32(c->B_Cb, cbi0, 4));
+				__m256i b1 = _mm256_add_epi32(y1, _mm256_i32gather_epi32(c->B_Cb, cbi1, 4));
+
+				// The packs work within 128-bit lanes, so the pixel order is
+				// 0-3, 8-11 | 4-7, 12-15 afterwards. The 16-bit interleave
+				// below picks the halves such that the order is restored.
+				__m256i r = _mm256_packs_epi32(_mm256_srai_epi32(r0, 18), _mm256_srai_epi32(r1, 18));
+				__m256i g = _mm256_packs_epi32(_mm256_srai_epi32(g0, 18), _mm256_srai_epi32(g1, 18));
+				__m256i b = _mm256_packs_epi32(_mm256_srai_epi32(b0, 18), _mm256_srai_epi32(b1, 18));
+				r = _mm256_packus_epi16(r, r);
+				g = _mm256_packus_epi16(g, g);
+				b = _mm256_packus_epi16(b, b);
+
+				__m256i bg = _mm256_unpacklo_epi8(b, g);
+				__m256i ra = _mm256_unpacklo_epi8(r, alpha);
+				_mm256_storeu_si256((__m256i *)dptr, _mm256_unpacklo_epi16(bg, ra));
+				_mm256_storeu_si256((__m256i *)(dptr + 8), _mm256_unpackhi_epi16(bg, ra));
+
+				yptr += 16;
+				cbptr += 16;
+				crptr += 16;
+				dptr += 16;
+			}
+			convertRowTables(c, yptr, cbptr, crptr, dptr, width - x);
+		}
+#endif // QMP_YUV_SIMD
+
+		// Rounding towards zero
+		static inline int zround(double n)
+		{
+			if (n >= 0) {
+				return (int)(n + 0.5);
+			} else {
+				return (int)(n - 0.5);
+			}
+		}
+
+		// Initializes the YCbCr -> RGB conversion tables (again, from mjpegtools)
+		void initTables(void)
+		{
+			/* clip Y values under 16 */
+			for (int i = 0; i < 16; i++) {
+				RGB_Y[i] = zround((1.0 * (double)(16 - 16) * 255.0 / 219.0 * (double)(1<<18)) + (double)(1<<(18-1)));
+			}
+			for (int i = 16; i < 236; i++) {
+				RGB_Y[i] = zround((1.0 * (double)(i - 16) * 255.0 / 219.0 * (double)(1<<18)) + (double)(1<<(18-1)));
+			}
+			/* clip Y values above 235 */
+			for (int i = 236; i < 256; i++) {
+				RGB_Y[i] = zround((1.0 * (double)(235 - 16)  * 255.0 / 219.0 * (double)(1<<18)) + (double)(1<<(18-1)));
+			}
+
+			/* clip Cb/Cr values below 16 */
+			for (int i = 0; i < 16; i++) {
+				R_Cr[i] = zround(1.402 * (double)(-112) * 255.0 / 224.0 * (double)(1<<18));
+				G_Cr[i] = zround(-0.714136 * (double)(-112) * 255.0 / 224.0 * (double)(1<<18));
+				G_Cb[i] = zround(-0.344136 * (double)(-112) * 255.0 / 224.0 * (double)(1<<18));
+				B_Cb[i] = zround(1.772 * (double)(-112) * 255.0 / 224.0 * (double)(1<<18));
+			}
+			for (int i = 16; i < 241; i++) {
+				R_Cr[i] = zround(1.402 * (double)(i - 128) * 255.0 / 224.0 * (double)(1<<18));
+				G_Cr[i] = zround(-0.714136 * (double)(i - 128) * 255.0 / 224.0 * (double)(1<<18));
+				G_Cb[i] = zround(-0.344136 * (double)(i - 128) * 255.0 / 224.0 * (double)(1<<18));
+				B_Cb[i] = zround(1.772 * (double)(i - 128) * 255.0 / 224.0 * (double)(1<<18));
+			}
+			/* clip Cb/Cr values above 240 */
+			for (int i = 241; i < 256; i++) {
+				R_Cr[i] = zround(1.402 * (double)(112) * 255.0 / 224.0 * (double)(1<<18));
+				G_Cr[i] = zround(-0.714136 * (double)(112) * 255.0 / 224.0 * (double)(1<<18));
+				G_Cb[i] = zround(-0.344136 * (double)(i - 128) * 255.0 / 224.0 * (double)(1<<18));
+				B_Cb[i] = zround(1.772 * (double)(112) * 255.0 / 224.0 * (double)(1<<18));
+			}
+		}
+
+	private:
+		// Conversion tables
+		int RGB_Y[256];
+		int R_Cr[256];
+		int G_Cb[256];
+		int G_Cr[256];
+		int B_Cb[256];
+
+		RowKernel m_rowKernel;
+		UpsampleKernel m_upsampleKernel;
+		Upsample422Kernel m_upsample422Kernel;
+		const char *m_kernelName;
+};
+
+
+// Internal resampler that converts frames directly at a different size. For
+// each output row, the luma and chroma samples are resampled to the output
+// width (using the nearest samples or bilinear interpolation), and the
+// resulting row is passed to the converter's row kernel. Thus, the source
+// frame is never converted at full resolution.
+class QMPYuvScaler
+{
+	public:
+		// Constructor
+		QMPYuvScaler()
+			: m_layout(QMPYuvConverter::Layout420), m_width(0), m_height(0), m_dwidth(0), m_dheight(0), m_smooth(false)
+		{
+
+		}
+
+		// Prepares the sample positions for scaling frames of the given size
+		// and layout. Nothing will be done if the parameters didn't change.
+		void setup(QMPYuvConverter::Layout layout, int width, int height, int dwidth, int dheight, bool smooth)
+		{
+			if (layout == m_layout && width == m_width && height == m_height && dwidth == m_dwidth && dheight == m_dheight && smooth == m_smooth) {
+				return;
+			}
+			m_layout = layout;
+			m_width = width;
+			m_height = height;
+			m_dwidth = dwidth;
+			m_dheight = dheight;
+			m_smooth = smooth;
+
+			// Chroma samples are centered between the luma samples for 4:2:0
+			// and co-sited with the even luma samples for 4:2:2, as assumed by
+			// the upsampling code of the converter
+			m_cwidth = (layout == QMPYuvConverter::Layout444 ? width : (width + 1) / 2);
+			m_cheight = (layout == QMPYuvConverter::Layout420 ? (height + 1) / 2 : height);
+			setupAxis(&m_lumaX, width, width, dwidth, 1, 0.0);
+			setupAxis(&m_lumaY, height, height, dheight, 1, 0.0);
+			switch (layout) {
+				case QMPYuvConverter::Layout420:
+					setupAxis(&m_chromaX, width, m_cwidth, dwidth, 2, 0.5);
+					setupAxis(&m_chromaY, height, m_cheight, dheight, 2, 0.5);
+					break;
+				case QMPYuvConverter::Layout422:
+					setupAxis(&m_chromaX, width, m_cwidth, dwidth, 2, 0.0);
+					setupAxis(&m_chromaY, height, m_cheight, dheight, 1, 0.0);
+					break;
+				default:
+					m_chromaX = m_lumaX;
+					m_chromaY = m_lumaY;
+					break;
+			}
+		}
+
+		// Converts the output rows [first, last) of a frame. This is
+		// thread-safe for disjoint row ranges.
+		void convert(const QMPYuvConverter &converter, unsigned char *planes[], uchar *dest, int bytesPerLine, int first = 0, int last = -1) const
+		{
+			if (last < 0 || last > m_dheight) {
+				last = m_dheight;
+			}
+
+			QVarLengthArray<uchar, 3 * 2048> lines(3 * m_dwidth);
+			uchar *yline = lines.data();
+			uchar *cbline = yline + m_dwidth;
+			uchar *crline = cbline + m_dwidth;
+
+			for (int y = first; y < last; y++) {
+				sampleRow(planes[0], m_width, m_lumaY, y, m_lumaX, yline);
+				sampleRow(planes[1], m_cwidth, m_chromaY, y, m_chromaX, cbline);
+				sampleRow(planes[2], m_cwidth, m_chromaY, y, m_chromaX, crline);
+				converter.convertRow(yline, cbline, crline, (QRgb *)(dest + y * bytesPerLine), m_dwidth);
+			}
+		}
+
+	private:
+		// Source sample positions for each output sample along one axis. The
+		// weights of the second sample are given in 1/256.
+		struct Axis {
+			QVector<int> first;
+			QVector<int> second;
+			QVector<int> weight;
+		};
+
+		// Maps output samples to source samples. \p subsampling is the
+		// number of luma samples per source sample, and \p offset is the
+		// position of the first source sample in luma coordinates.
+		void setupAxis(Axis *axis, int size, int ssize, int dsize, int subsampling, double offset)
+		{
+			axis->first.resize(dsize);
+			axis->second.resize(dsize);
+			axis->weight.resize(dsize);
+			for (int i = 0; i < dsize; i++) {
+				// Pixel centers are aligned
+				double pos = ((i + 0.5) * size / dsize - 0.5 - offset) / subsampling;
+				pos = qBound(0.0, pos, ssize - 1.0);
+				int index = int(pos);
+				int weight = qRound((pos - index) * 256);
+				if (!m_smooth) {
+					index = qMin(index + (weight >= 128 ? 1 : 0), ssize - 1);
+					weight = 0;
+				} else if (weight == 256) {
+					index = qMin(index + 1, ssize - 1);
+					weight = 0;
+				}
+				axis->first[i] = index;
+				axis->second[i] = qMin(index + 1, ssize - 1);
+				axis->weight[i] = weight;
+			}
+		}
+
+		// Resamples a single row of a plane
+		void sampleRow(const uchar *plane, int stride, const Axis &ya, int y, const Axis &xa, uchar *dest) const
+		{
+			const uchar *top = plane + ya.first[y] * stride;
+			const int *first = xa.first.constData();
+			if (!m_smooth) {
+				for (int x = 0; x < m_dwidth; x++) {
+					dest[x] = top[first[x]];
+				}
+				return;
+			}
+
+			const uchar *bottom = plane + ya.second[y] * stride;
+			const int *second = xa.second.constData();
+			const int *weight = xa.weight.constData();
+			const int wy = ya.weight[y];
+			for (int x = 0; x < m_dwidth; x++) {
+				const int wx = weight[x];
+				const int t = top[first[x]] * (256 - wx) + top[second[x]] * wx;
+				const int b = bottom[first[x]] * (256 - wx) + bottom[second[x]] * wx;
+				dest[x] = (t * (256 - wy) + b * wy + 32768) >> 16;
+			}
+		}
+
+	private:
+		QMPYuvConverter::Layout m_layout;
+		int m_width, m_height;
+		int m_cwidth, m_cheight;
+		int m_dwidth, m_dheight;
+		bool m_smooth;
+
+		Axis m_lumaX, m_lumaY;
+		Axis m_chromaX, m_chromaY;
+};
+
+
+// Converts a horizontal band of a frame in a worker thread
+class QMPYuvSlice : public QRunnable
+{
+	public:
+		QMPYuvSlice(const QMPYuvConverter *converter, const QMPYuvScaler *scaler, QSemaphore *done)
+			: m_converter(converter), m_scaler(scaler), m_done(done)
+		{
+			// Slices are reused for every frame
+			setAutoDelete(false);
+		}
+
+		void setup(QMPYuvConverter::Layout layout, unsigned char **planes, uchar *dest, int bytesPerLine, int width, int height, int first, int last, bool scale)
+		{
+			m_layout = layout;
+			m_scale = scale;
+			m_planes = planes;
+			m_dest = dest;
+			m_bytesPerLine = bytesPerLine;
+			m_width = width;
+			m_height = height;
+			m_first = first;
+			m_last = last;
+		}
+
+		void run()
+		{
+			QMP_TRACE_SCOPE("convertSlice");
+			if (m_scale) {
+				m_scaler->convert(*m_converter, m_planes, m_dest, m_bytesPerLine, m_first, m_last);
+			} else {
+				m_converter->convert(m_layout, m_planes, m_dest, m_bytesPerLine, m_width, m_height, m_first, m_last);
+			}
+			m_done->release();
+		}
+
+	private:
+		const QMPYuvConverter *m_converter;
+		const QMPYuvScaler *m_scaler;
+		QSemaphore *m_done;
+
+		QMPYuvConverter::Layout m_layout;
+		bool m_scale;
+		unsigned char **m_planes;
+		uchar *m_dest;
+		int m_bytesPerLine;
+		int m_width, m_height;
+		int m_first, m_last;
+};
+
+
+// Internal frame converter that splits frames into horizontal bands, which
+// are converted by a private worker pool and the calling thread. If the
+// image size differs from the frame size, the frame is resampled while
+// converting it.
+class QMPYuvBandConverter
+{
+	public:
+		~QMPYuvBandConverter()
+		{
+			m_pool.waitForDone();
+			qDeleteAll(m_slices);
+		}
+
+		// Converts a frame into \p image, using up to \p threads bands
+		void convert(QMPYuvConverter::Layout layout, unsigned char *planes[], QImage *image, int width, int height, int threads, bool smooth)
+		{
+			QMP_TRACE_SCOPE("convertFrame");
+			// Detach once, before any worker touches the image data
+			uchar *dest = image->bits();
+			const int bytesPerLine = image->bytesPerLine();
+
+			const bool scale = (image->width() != width || image->height() != height);
+			if (scale) {
+				m_scaler.setup(layout, width, height, image->width(), image->height(), smooth);
+			}
+			const int rows = image->height();
+
+			// Very small bands aren't worth the synchronization overhead
+			int bands = qBound(1, threads, qMax(1, rows / 32));
+			if (bands == 1) {
+				convertBand(layout, planes, dest, bytesPerLine, width, height, 0, rows, scale);
+				return;
+			}
+
+			while (m_slices.count() < bands - 1) {
+				m_slices.append(new QMPYuvSlice(&m_converter, &m_scaler, &m_slicesDone));
+			}
+			if (m_pool.maxThreadCount() != bands - 1) {
+				m_pool.setMaxThreadCount(bands - 1);
+			}
+
+			// Bands consist of whole row pairs because of the 4:2:0 chroma
+			// subsampling (which doesn't hurt for the other layouts). The last
+			// band is converted in this thread.
+			const int pairs = (rows + 1) / 2;
+			int first = 0;
+			for (int i = 0; i < bands - 1; i++) {
+				int last = 2 * ((i + 1) * pairs / bands);
+				m_slices[i]->setup(layout, planes, dest, bytesPerLine, width, height, first, last, scale);
+				m_pool.start(m_slices[i]);
+				first = last;
+			}
+			convertBand(layout, planes, dest, bytesPerLine, width, height, first, rows, scale);
+			m_slicesDone.acquire(bands - 1);
+		}
+
+	private:
+		// Converts the image rows [first, last) in this thread
+		void convertBand(QMPYuvConverter::Layout layout, unsigned char *planes[], uchar *dest, int bytesPerLine, int width, int height, int first, int last, bool scale)
+		{
+			if (scale) {
+				m_scaler.convert(m_converter, planes, dest, bytesPerLine, first, last);
+			} else {
+				m_converter.convert(layout, planes, dest, bytesPerLine, width, height, first, last);
+			}
+		}
+
+	private:
+		QMPYuvConverter m_converter;
+		QMPYuvScaler m_scaler;
+		QThreadPool m_pool;
+		QList<QMPYuvSlice *> m_slices;
+		QSemaphore m_slicesDone;
+};
+
+
+#endif // QMPYUVCONVERTER_H_
@@ -19,15 +19,325 @@
 
 #include <QImage>
 #include <QDir>
+#include <QList>
 #include <QMutex>
+#include <QSharedPointer>
 #include <QThread>
 
 #ifdef Q_WS_WIN
  #include "windows.h"
 #endif
 
-#include <cstdio>
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "qmpframequeue.h"
+#include "qmpstatistics.h"
+#include "qmptrace.h"
+#include "qmpyuvconverter.h"
+
+
+// Buffered input from the YUV pipe. Frame data is read directly into the
+// destination buffer with a single readv(2) call, which also fills the internal
+// buffer with the data following it (e.g. the next frame header). Thus, a
+// frame usually costs only a few system calls, depending on how MPlayer
+// writes it. The pipe is read without blocking, and if no data is available,
+// the input waits for either the pipe or the \p wakeup file descriptor to
+// become readable. The latter lets reads fail if the reader is stopped.
+class QMPPipeInput
+{
+	public:
+		QMPPipeInput(int bufferSize, int wakeup)
+			: m_fd(-1), m_wakeup(wakeup), m_size(qMax(bufferSize, 4096)), m_pos(0), m_end(0), m_calls(0), m_eof(false)
+		{
+			m_buffer = new char[m_size];
+		}
+
+		~QMPPipeInput()
+		{
+			if (m_fd >= 0) {
+				::close(m_fd);
+			}
+			delete[] m_buffer;
+		}
+
+		// Opens the pipe. This blocks until the pipe has been opened for writing.
+		bool open(const QString &path)
+		{
+			do {
+				m_fd = ::open(QFile::encodeName(path).constData(), O_RDONLY);
+			} while (m_fd < 0 && errno == EINTR);
+			if (m_fd < 0) {
+				return false;
+			}
+			fcntl(m_fd, F_SETFL, fcntl(m_fd, F_GETFL) | O_NONBLOCK);
+
+#ifdef F_SETPIPE_SZ
+			// Enlarge the pipe so that MPlayer can write more data at once. The
+			// size may exceed the system limit, so try smaller sizes, too.
+			for (int size = m_size; size >= 65536; size /= 2) {
+				if (fcntl(m_fd, F_SETPIPE_SZ, size) >= 0) {
+					break;
+				}
+			}
+#endif
+			return true;
+		}
+
+		// Reads exactly \p n bytes. Returns false on errors or end of file.
+		bool read(void *dest, qint64 n)
+		{
+			char *d = static_cast<char *>(dest);
+
+			// Buffered data comes first
+			qint64 c = qMin(n, qint64(m_end - m_pos));
+			if (c > 0) {
+				memcpy(d, m_buffer + m_pos, c);
+				m_pos += c;
+				d += c;
+				n -= c;
+			}
+
+			// The buffer is empty now
+			while (n > 0) {
+				struct iovec iov[2];
+				iov[0].iov_base = d;
+				iov[0].iov_len = n;
+				iov[1].iov_base = m_buffer;
+				iov[1].iov_len = m_size;
+
+				ssize_t r;
+				do {
+					r = readv(m_fd, iov, 2);
+					++m_calls;
+				} while ((r < 0 && errno == EINTR) || (r < 0 && errno == EAGAIN && waitForData()));
+				if (r <= 0) {
+					m_eof = (r == 0);
+					return false;
+				}
+
+				if (r > n) {
+					m_pos = 0;
+					m_end = r - n;
+					r = n;
+				}
+				d += r;
+				n -= r;
+			}
+			return true;
+		}
+
+		// Reads a line, not including the line break. Lines longer than
+		// \p maxlen are treated as errors.
+		bool readLine(QByteArray *line, int maxlen = 4096)
+		{
+			line->clear();
+			while (true) {
+				if (m_pos == m_end && !fill()) {
+					return false;
+				}
+
+				const char *start = m_buffer + m_pos;
+				const char *end = static_cast<const char *>(memchr(start, '\n', m_end - m_pos));
+				int len = (end != NULL ? end - start : m_end - m_pos);
+				if (line->size() + len > maxlen) {
+					return false;
+				}
+				line->append(start, len);
+				if (end != NULL) {
+					m_pos += len + 1;
+					return true;
+				}
+				m_pos = m_end;
+			}
+		}
+
+		// Returns the number of read system calls so far
+		quint64 readCalls() const
+		{
+			return m_calls;
+		}
+
+		// Returns true if reading failed because MPlayer has closed the pipe
+		bool atEnd() const
+		{
+			return m_eof;
+		}
+
+	private:
+		bool fill()
+		{
+			ssize_t r;
+			do {
+				r = ::read(m_fd, m_buffer, m_size);
+				++m_calls;
+			} while ((r < 0 && errno == EINTR) || (r < 0 && errno == EAGAIN && waitForData()));
+			if (r <= 0) {
+				m_eof = (r == 0);
+				return false;
+			}
+			m_pos = 0;
+			m_end = r;
+			return true;
+		}
+
+		// Waits until the pipe becomes readable (or has been closed by
+		// MPlayer). Returns false if the input has been woken up instead.
+		bool waitForData()
+		{
+			struct pollfd fds[2];
+			fds[0].fd = m_fd;
+			fds[0].events = POLLIN;
+			fds[1].fd = m_wakeup;
+			fds[1].events = POLLIN;
+			int r;
+			do {
+				fds[0].revents = fds[1].revents = 0;
+				r = poll(fds, (m_wakeup >= 0 ? 2 : 1), -1);
+			} while (r < 0 && errno == EINTR);
+			return (r > 0 && fds[1].revents == 0);
+		}
+
+	private:
+		int m_fd;
+		int m_wakeup;
+		char *m_buffer;
+		int m_size;
+		int m_pos, m_end;
+		quint64 m_calls;
+		bool m_eof;
+};
+
+
+// Parsed yuv4mpeg2 stream header, as described in the yuv4mpeg(5) manual page
+// of the mjpegtools
+class QMPYuvHeader
+{
+	public:
+		// The 4:2:0 variants differ in chroma siting only, which is ignored
+		enum Chroma {
+			Chroma420 = 0,
+			Chroma422,
+			Chroma444,
+			ChromaMono
+		};
+
+		QMPYuvHeader()
+			: width(0), height(0), fpsNum(0), fpsDen(0), interlacing('?'), aspectNum(0), aspectDen(0),
+			  chroma(Chroma420)
+		{
+
+		}
+
+		// Parses a stream header line
+		bool parse(const QByteArray &line)
+		{
+			QList<QByteArray> tags = line.split(' ');
+			if (tags.first() != "YUV4MPEG2") {
+				return false;
+			}
+
+			bool ok = true;
+			for (int i = 1; i < tags.count() && ok; i++) {
+				const QByteArray &tag = tags[i];
+				if (tag.isEmpty()) {
+					continue;
+				}
+
+				QByteArray value = tag.mid(1);
+				switch (tag[0]) {
+					case 'W': width = value.toInt(&ok); break;
+					case 'H': height = value.toInt(&ok); break;
+					case 'F': ok = parseRatio(value, &fpsNum, &fpsDen); break;
+					case 'A': ok = parseRatio(value, &aspectNum, &aspectDen); break;
+					case 'I':
+						ok = (value.length() == 1);
+						interlacing = (ok ? value.at(0) : '?');
+						break;
+					case 'C': ok = parseChroma(value); break;
+					default: break; // X tags and unknown tags are ignored
+				}
+			}
+			return (ok && width > 0 && height > 0);
+		}
+
+		// Parses a frame header line. Frame parameters are validated, but not
+		// used at the moment.
+		static bool parseFrame(const QByteArray &line)
+		{
+			if (!line.startsWith("FRAME")) {
+				return false;
+			}
+			return (line.length() == 5 || line[5] == ' ');
+		}
+
+		// Returns the size of the chroma planes. Monochrome frames are
+		// extended to 4:2:0 using neutral chroma planes.
+		int cwidth() const
+		{
+			return (chroma == Chroma444 ? width : (width + 1) / 2);
+		}
+		int cheight() const
+		{
+			return (chroma == Chroma420 || chroma == ChromaMono ? (height + 1) / 2 : height);
+		}
+
+		// Returns the layout used for conversion
+		QMPYuvConverter::Layout layout() const
+		{
+			switch (chroma) {
+				case Chroma422: return QMPYuvConverter::Layout422;
+				case Chroma444: return QMPYuvConverter::Layout444;
+				default: return QMPYuvConverter::Layout420;
+			}
+		}
+
+		// Returns the number of bytes per frame in the stream
+		int frameSize() const
+		{
+			return width * height + (chroma == ChromaMono ? 0 : 2 * cwidth() * cheight());
+		}
+
+	private:
+		static bool parseRatio(const QByteArray &value, int *num, int *den)
+		{
+			int i = value.indexOf(':');
+			if (i < 0) {
+				return false;
+			}
+			bool ok1, ok2;
+			*num = value.left(i).toInt(&ok1);
+			*den = value.mid(i + 1).toInt(&ok2);
+			return (ok1 && ok2);
+		}
+
+		bool parseChroma(const QByteArray &value)
+		{
+			if (value == "420jpeg" || value == "420mpeg2" || value == "420paldv" || value == "420") {
+				chroma = Chroma420;
+			} else if (value == "422") {
+				chroma = Chroma422;
+			} else if (value == "444") {
+				chroma = Chroma444;
+			} else if (value == "mono") {
+				chroma = ChromaMono;
+			} else {
+				return false;
+			}
+			return true;
+		}
+
+	public:
+		int width, height;
+		int fpsNum, fpsDen;
+		char interlacing;
+		int aspectNum, aspectDen;
+		Chroma chroma;
+};
 
 
 // Internal YUV pipe reader
@@ -37,9 +347,18 @@ class QMPYuvReader : public QThread
 
 	public:
 		// Constructor
-		QMPYuvReader(QObject *parent = 0)
-			: QThread(parent), m_stop(false), m_saveme(NULL), m_savemeSize(-1)
+		QMPYuvReader(const QSharedPointer<QMPFrameQueue> &queue, QObject *parent = 0)
+			: QThread(parent), m_stop(false), m_writer(-1), m_bufferSize(1048576),
+			  m_queue(queue), m_scalingMode(Qt::SmoothTransformation), m_threads(1)
 		{
+			// Writing to this pipe wakes up the thread if it's waiting for data
+			if (::pipe(m_wakeup) != 0) {
+				qWarning("Can't create wakeup pipe");
+				m_wakeup[0] = m_wakeup[1] = -1;
+			} else {
+				fcntl(m_wakeup[1], F_SETFL, fcntl(m_wakeup[1], F_GETFL) | O_NONBLOCK);
+			}
+
 			QString tdir = QDir::tempPath();
 
 			// Create pipe in a temporary directory
@@ -57,233 +376,281 @@ class QMPYuvReader : public QThread
 			}
 			m_pipe = QString(temp);
 			delete[] temp;
-
-			initTables();
 		}
 
-		// Destructor
+		// Destructor. The thread has finished already, since the reader is
+		// deleted by stop().
 		~QMPYuvReader()
 		{
-			delete[] m_saveme;
+			wait();
+			for (int i = 0; i < 2; i++) {
+				if (m_wakeup[i] >= 0) {
+					::close(m_wakeup[i]);
+				}
+			}
+			if (m_writer >= 0) {
+				::close(m_writer);
+			}
 			if (!m_pipe.isEmpty()) {
 				QFile::remove(m_pipe);
 				QDir().rmdir(QFileInfo(m_pipe).dir().path());
 			}
 		}
 
-		// Tells the thread to stop and exit
+		// Tells the thread to stop and exit. This never blocks: The reader
+		// deletes itself once the thread has finished, so it mustn't be used
+		// afterwards.
 		void stop()
 		{
 			m_mutex.lock();
+			if (m_stop) {
+				m_mutex.unlock();
+				return;
+			}
 			m_stop = true;
 			m_mutex.unlock();
-			wait();
+			m_queue->abort();
+
+			// Wake up the thread if it's waiting for data, even if MPlayer
+			// keeps the pipe open
+			if (m_wakeup[1] >= 0) {
+				char c = 0;
+				if (::write(m_wakeup[1], &c, 1) < 0) {
+					qWarning("Can't wake up YUV reader");
+				}
+			}
+
+			// If MPlayer didn't open the pipe, the thread may be waiting for a
+			// writer in open(). It opens the pipe for reading before checking
+			// m_stop, so opening it for writing here succeeds in that case. The
+			// pipe is kept open, since open() ignores writers that are gone.
+			m_writer = ::open(QFile::encodeName(m_pipe).constData(), O_WRONLY | O_NONBLOCK);
+
+			setParent(NULL);
+			connect(this, SIGNAL(finished()), this, SLOT(deleteLater()));
+			if (!isRunning()) {
+				deleteLater();
+			}
+		}
+
+		// Sets the number of threads used for converting a frame. If
+		// \p threads is 0, QThread::idealThreadCount() will be used.
+		void setThreadCount(int threads)
+		{
+			QMutexLocker locker(&m_mutex);
+			m_threads = qMax(0, threads);
+		}
+
+		// Sets the filter used if frames need to be scaled to the size
+		// requested by the video widget
+		void setScalingMode(Qt::TransformationMode mode)
+		{
+			QMutexLocker locker(&m_mutex);
+			m_scalingMode = mode;
+		}
+
+		// Sets the size of the read buffer and the pipe, which takes effect
+		// when the thread is started
+		void setBufferSize(int size)
+		{
+			QMutexLocker locker(&m_mutex);
+			m_bufferSize = size;
+		}
+
+		// Returns the average number of read system calls per frame
+		double syscallsPerFrame()
+		{
+			QMutexLocker locker(&m_mutex);
+			return (m_statistics.framesRead > 0 ? double(m_statistics.readCalls) / m_statistics.framesRead : 0.0);
 		}
 
+		// Returns a copy of the frame counters and stage latencies
+		QMPReaderStatistics statistics()
+		{
+			QMutexLocker locker(&m_mutex);
+			return m_statistics;
+		}
+
+	signals:
+		// Emitted if MPlayer has closed the pipe, which happens once a file
+		// has been played completely
+		void endOfStream();
+
 	protected:
 		// Main thread loop
 		void run()
 		{
-			FILE *f = fopen(m_pipe.toLocal8Bit().data(), "rb");
-			if (f == NULL) {
+			QMP_TRACE_THREAD("YUV reader");
+			// Opening the pipe for reading without blocking first lets stop()
+			// open it for writing, which ends the blocking open() below
+			int keeper = ::open(QFile::encodeName(m_pipe).constData(), O_RDONLY | O_NONBLOCK);
+			m_mutex.lock();
+			QMPPipeInput in(m_bufferSize, m_wakeup[0]);
+			bool stopped = m_stop;
+			m_mutex.unlock();
+			bool opened = (!stopped && in.open(m_pipe));
+			if (keeper >= 0) {
+				::close(keeper);
+			}
+			if (stopped) {
+				return;
+			} else if (!opened) {
 				qWarning("Can't open pipe");
 				return;
 			}
 
+			// stop() might have opened the pipe just for waking us up
+			if (isStopped()) {
+				return;
+			}
+
 			// Parse stream header
-			char c;
-			int width, height, fps, t1, t2;
-			int n = fscanf(f, "YUV4MPEG2 W%d H%d F%d:1 I%c A%d:%d", &width, &height, &fps, &c, &t1, &t2);
-			if (n < 3) {
-				fclose(f);
+			QByteArray line;
+			if (!in.readLine(&line)) {
+				if (!isStopped()) {
+					qWarning("Can't read from pipe");
+				}
+				return;
+			}
+			QMPYuvHeader header;
+			if (!header.parse(line)) {
 				qWarning("Unsupported pipe format");
 				return;
 			}
 
-			unsigned char *yuv[3];
-			yuv[0] = new unsigned char[width * height];
-			yuv[1] = new unsigned char[width * height];
-			yuv[2] = new unsigned char[width * height];
-
-			QImage image(width, height, QImage::Format_ARGB32);
+			// The chroma planes are kept at their native size
+			const int width = header.width;
+			const int height = header.height;
+			const int cwidth = header.cwidth();
+			const int cheight = header.cheight();
+			const unsigned int ysize = width * height;
+			const unsigned int csize = cwidth * cheight;
+			const bool mono = (header.chroma == QMPYuvHeader::ChromaMono);
+			unsigned char *buffer = new unsigned char[ysize + 2 * csize];
+			memset(buffer + ysize, 128, 2 * csize);
 
 			// Read frames
-			const unsigned int ysize = width * height;
-			const unsigned int csize = width * height / 4;
+			QMPFrame *frame;
+			quint64 number;
+			qint64 start, end;
+			unsigned char *yuv[3];
 			while (true) {
 				m_mutex.lock();
+				m_statistics.readCalls = in.readCalls();
 				if (m_stop) {
 					m_mutex.unlock();
 					break;
 				}
 				m_mutex.unlock();
 
-				if (fread(yuv[0], 1, 6, f) != 6) {
-					goto ioerror;
+				// Frames are read directly into the frame buffer if the video
+				// widget handles YUV data. Otherwise, they will be converted
+				// from the reader's buffer. If there's no frame buffer, the
+				// data is read anyway but the frame is dropped.
+				frame = m_queue->acquire(width, height, cwidth, cheight);
+				if (frame != NULL && frame->format == QMPFrame::YuvFormat) {
+					yuv[0] = frame->plane(0);
+					yuv[1] = frame->plane(1);
+					yuv[2] = frame->plane(2);
+				} else {
+					yuv[0] = buffer;
+					yuv[1] = buffer + ysize;
+					yuv[2] = buffer + ysize + csize;
 				}
-				if (fread(yuv[0], 1, ysize, f) != ysize) {
-					goto ioerror;
+
+				// The planes are stored contiguously, so they're read at once.
+				// The read time includes waiting for MPlayer.
+				start = qmpMicroseconds();
+				{
+					QMP_TRACE_SCOPE("readFrame");
+					if (!in.readLine(&line) || !QMPYuvHeader::parseFrame(line)) {
+						goto ioerror;
+					}
+					if (!in.read(yuv[0], header.frameSize())) {
+						goto ioerror;
+					}
 				}
-				if (fread(yuv[1], 1, csize, f) != csize) {
-					goto ioerror;
+				if (mono && yuv[0] != buffer) {
+					memset(yuv[1], 128, 2 * csize);
 				}
-				if (fread(yuv[2], 1, csize, f) != csize) {
-					goto ioerror;
+
+				end = qmpMicroseconds();
+				m_mutex.lock();
+				number = m_statistics.framesRead++;
+				m_statistics.read.add(end - start);
+				m_mutex.unlock();
+				if (frame == NULL) {
+					continue;
+				}
+				if (frame->format == QMPFrame::RgbFormat) {
+					start = end;
+					m_converter.convert(header.layout(), yuv, &frame->image, width, height, threadCount(), scalingMode() == Qt::SmoothTransformation);
+					end = qmpMicroseconds();
+					m_mutex.lock();
+					++m_statistics.framesConverted;
+					m_statistics.convert.add(end - start);
+					m_mutex.unlock();
 				}
-				supersample(yuv[1], width, height);
-				supersample(yuv[2], width, height);
-				yuvToQImage(yuv, &image, width, height);
 
-				emit imageReady(image);
+				// yuv4mpeg streams don't contain timestamps, but MPlayer writes
+				// every frame, so the time follows from the frame rate
+				frame->time = (header.fpsNum > 0 && header.fpsDen > 0 ? qint64(number) * 1000 * header.fpsDen / header.fpsNum : -1);
+				QMP_TRACE_EVENT("publishFrame", int(number));
+				m_queue->publish(frame);
 				continue;
 
 ioerror:
-				qWarning("I/O error reading from pipe");
-				break;
-			}
-
-			delete[] yuv[0];
-			delete[] yuv[1];
-			delete[] yuv[2];
-			fclose(f);
-		}
-
-		// 420 to 444 supersampling (from mjpegtools)
-		void supersample(unsigned char *buffer, int width, int height)
-		{
-			unsigned char *inm, *in0, *inp, *out0, *out1;
-			unsigned char cmm, cm0, cmp, c0m, c00, c0p, cpm, cp0, cpp;
-			int x, y;
-
-			if (m_saveme == NULL || width > m_savemeSize) {
-				delete[] m_saveme;
-				m_savemeSize = width;
-				m_saveme = new unsigned char[m_savemeSize];
-			}
-			memcpy(m_saveme, buffer, width);
-
-			in0 = buffer + (width * height / 4) - 2;
-			inm = in0 - width/2;
-			inp = in0 + width/2;
-			out1 = buffer + (width * height) - 1;
-			out0 = out1 - width;
-
-			for (y = height; y > 0; y -= 2) {
-				if (y == 2) {
-					in0 = m_saveme + width/2 - 2;
-					inp = in0 + width/2;
+				if (frame != NULL) {
+					m_queue->release(frame);
 				}
-				for (x = width; x > 0; x -= 2) {
-					cmm = ((x == 2) || (y == 2)) ? in0[1] : inm[0];
-					cm0 = (y == 2) ? in0[1] : inm[1];
-					cmp = ((x == width) || (y == 2)) ? in0[1] : inm[2];
-					c0m = (x == 2) ? in0[1] : in0[0];
-					c00 = in0[1];
-					c0p = (x == width) ? in0[1] : in0[2];
-					cpm = ((x == 2) || (y == height)) ? in0[1] : inp[0];
-					cp0 = (y == height) ? in0[1] : inp[1];
-					cpp = ((x == width) || (y == height)) ? in0[1] : inp[2];
-					inm--;
-					in0--;
-					inp--;
-
-					*(out1--) = (1*cpp + 3*(cp0+c0p) + 9*c00 + 8) >> 4;
-					*(out1--) = (1*cpm + 3*(cp0+c0m) + 9*c00 + 8) >> 4;
-					*(out0--) = (1*cmp + 3*(cm0+c0p) + 9*c00 + 8) >> 4;
-					*(out0--) = (1*cmm + 3*(cm0+c0m) + 9*c00 + 8) >> 4;
+				if (in.atEnd() && !isStopped()) {
+					emit endOfStream();
+				} else if (!isStopped()) {
+					qWarning("I/O error reading from pipe");
 				}
-				out1 -= width;
-				out0 -= width;
+				break;
 			}
+
+			delete[] buffer;
+#ifdef QMP_DEBUG_OUTPUT
+			qDebug("Read %llu frames, %.2f read calls per frame", m_statistics.framesRead, syscallsPerFrame());
+#endif
 		}
 
-		// Converts YCbCr data to a QImage
-		void yuvToQImage(unsigned char *planes[], QImage *dest, int width, int height)
+		bool isStopped()
 		{
-			unsigned char *yptr = planes[0];
-			unsigned char *cbptr = planes[1];
-			unsigned char *crptr = planes[2];
-
-			// This is partly from mjpegtools
-			for (int y = 0; y < height; y++) {
-				QRgb *dptr = (QRgb *)dest->scanLine(y);
-				for (int x = 0; x < width; x++) {
-					*dptr = qRgb(qBound(0, (RGB_Y[*yptr] + R_Cr[*crptr]) >> 18, 255),
-						qBound(0, (RGB_Y[*yptr] + G_Cb[*cbptr]+ G_Cr[*crptr]) >> 18, 255),
-						qBound(0, (RGB_Y[*yptr] + B_Cb[*cbptr]) >> 18, 255));
-					++yptr;
-					++cbptr;
-					++crptr;
-					++dptr;
-				}
-			}
+			QMutexLocker locker(&m_mutex);
+			return m_stop;
 		}
 
-		// Rounding towards zero
-		inline int zround(double n)
+		Qt::TransformationMode scalingMode()
 		{
-			if (n >= 0) {
-				return (int)(n + 0.5);
-			} else {
-				return (int)(n - 0.5);
-			}
+			QMutexLocker locker(&m_mutex);
+			return m_scalingMode;
 		}
 
-		// Initializes the YCbCr -> RGB conversion tables (again, from mjpegtools)
-		void initTables(void)
+		// Returns the effective number of conversion threads
+		int threadCount()
 		{
-			/* clip Y values under 16 */
-			for (int i = 0; i < 16; i++) {
-				RGB_Y[i] = zround((1.0 * (double)(16 - 16) * 255.0 / 219.0 * (double)(1<<18)) + (double)(1<<(18-1)));
-			}
-			for (int i = 16; i < 236; i++) {
-				RGB_Y[i] = zround((1.0 * (double)(i - 16) * 255.0 / 219.0 * (double)(1<<18)) + (double)(1<<(18-1)));
-			}
-			/* clip Y values above 235 */
-			for (int i = 236; i < 256; i++) {
-				RGB_Y[i] = zround((1.0 * (double)(235 - 16)  * 255.0 / 219.0 * (double)(1<<18)) + (double)(1<<(18-1)));
-			}
-
-			/* clip Cb/Cr values below 16 */   
-			for (int i = 0; i < 16; i++) {
-				R_Cr[i] = zround(1.402 * (double)(-112) * 255.0 / 224.0 * (double)(1<<18));
-				G_Cr[i] = zround(-0.714136 * (double)(-112) * 255.0 / 224.0 * (double)(1<<18));
-				G_Cb[i] = zround(-0.344136 * (double)(-112) * 255.0 / 224.0 * (double)(1<<18));
-				B_Cb[i] = zround(1.772 * (double)(-112) * 255.0 / 224.0 * (double)(1<<18));
-			}
-			for (int i = 16; i < 241; i++) {
-				R_Cr[i] = zround(1.402 * (double)(i - 128) * 255.0 / 224.0 * (double)(1<<18));
-				G_Cr[i] = zround(-0.714136 * (double)(i - 128) * 255.0 / 224.0 * (double)(1<<18));
-				G_Cb[i] = zround(-0.344136 * (double)(i - 128) * 255.0 / 224.0 * (double)(1<<18));
-				B_Cb[i] = zround(1.772 * (double)(i - 128) * 255.0 / 224.0 * (double)(1<<18));
-			}
-			/* clip Cb/Cr values above 240 */  
-			for (int i = 241; i < 256; i++) {
-				R_Cr[i] = zround(1.402 * (double)(112) * 255.0 / 224.0 * (double)(1<<18));
-				G_Cr[i] = zround(-0.714136 * (double)(112) * 255.0 / 224.0 * (double)(1<<18));
-				G_Cb[i] = zround(-0.344136 * (double)(i - 128) * 255.0 / 224.0 * (double)(1<<18));
-				B_Cb[i] = zround(1.772 * (double)(112) * 255.0 / 224.0 * (double)(1<<18));
-			}
+			QMutexLocker locker(&m_mutex);
+			return (m_threads > 0 ? m_threads : QThread::idealThreadCount());
 		}
 
-	signals:
-		void imageReady(const QImage &image);
-
 	public:
 		QString m_pipe;
 
 	private:
 		QMutex m_mutex;
 		bool m_stop;
+		int m_wakeup[2];
+		int m_writer;
 
-		// Conversion tables
-		int RGB_Y[256];
-		int R_Cr[256];
-		int G_Cb[256];
-		int G_Cr[256];
-		int B_Cb[256];
+		// Pipe input
+		int m_bufferSize;
+		QMPReaderStatistics m_statistics;
 
-		// Temporary buffers
-		unsigned char *m_saveme;
-		int m_savemeSize;
+		QSharedPointer<QMPFrameQueue> m_queue;
+		QMPYuvBandConverter m_converter;
+		Qt::TransformationMode m_scalingMode;
+		int m_threads;
 };
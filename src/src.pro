@@ -13,5 +13,6 @@ CONFIG += staticlib
 # Optional features
 QT += opengl
 CONFIG += pipemode
+#CONFIG += tracing
 
 include(qmpwidget.pri)
@@ -0,0 +1,17 @@
+#
+#  qmpwidget - A Qt widget for embedding MPlayer
+#  Copyright (C) 2010 by Jonas Gehring
+#
+
+TEMPLATE = app
+TARGET = tst_openglwidget
+CONFIG += qtestlib
+
+QT += opengl
+
+DEFINES += QMP_USE_YUVPIPE
+unix:!macx: LIBS += -lrt
+
+INCLUDEPATH += ../../src
+HEADERS += ../../src/qmpopenglwidget.h ../../src/qmpframequeue.h ../../src/qmpyuvconverter.h
+SOURCES += tst_openglwidget.cpp
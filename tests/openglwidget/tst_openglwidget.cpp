@@ -0,0 +1,152 @@
+/*
+ *  qmpwidget - A Qt widget for embedding MPlayer
+ *  Copyright (C) 2010 by Jonas Gehring
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <QtTest>
+
+#include "qmpopenglwidget.h"
+#include "qmpyuvconverter.h"
+
+
+Q_DECLARE_METATYPE(QMPFrame::Format)
+
+
+// Renders known frames through the OpenGL video widget and checks the pixels
+// that end up in the frame buffer. Without a hardware GPU, this can be run
+// with Mesa's software rasterizer, e.g.
+//   LIBGL_ALWAYS_SOFTWARE=1 xvfb-run ./tst_openglwidget
+class TestOpenGLWidget : public QObject
+{
+	Q_OBJECT
+
+	private slots:
+		void initTestCase()
+		{
+			if (!QGLFormat::hasOpenGL()) {
+				QSKIP("OpenGL is not available", SkipAll);
+			}
+		}
+
+		void frames_data()
+		{
+			QTest::addColumn<QMPFrame::Format>("format");
+
+			// YUV frames are uploaded as three GL_LUMINANCE textures and
+			// converted by the shader program. RGB frames are streamed
+			// through the pixel buffer objects if the implementation
+			// supports them (which is the case for llvmpipe).
+			QTest::newRow("yuv") << QMPFrame::YuvFormat;
+			QTest::newRow("rgb") << QMPFrame::RgbFormat;
+		}
+
+		// Presents two frames, where the second one consists of differently
+		// colored halves to check the orientation. The frames are converted
+		// by QMPYuvConverter as well, which is the reference for both paths.
+		void frames()
+		{
+			QFETCH(QMPFrame::Format, format);
+
+			const int width = 64, height = 64;
+			QMPOpenGLVideoWidget widget;
+			widget.resize(width, height);
+			widget.show();
+			QTest::qWaitForWindowShown(&widget);
+			if (!widget.isValid()) {
+				QSKIP("No OpenGL context", SkipSingle);
+			}
+
+			// Paints end up in the back buffer, where they can be read
+			widget.setAutoBufferSwap(false);
+
+			QSharedPointer<QMPFrameQueue> queue(new QMPFrameQueue());
+			widget.setFrameQueue(queue);
+			if (format == QMPFrame::YuvFormat) {
+				// The widget asks for YUV frames if it could compile the shader
+				QMPFrame *frame = queue->acquire(1, 1, 1, 1);
+				bool yuv = (frame->format == QMPFrame::YuvFormat);
+				queue->release(frame);
+				if (!yuv) {
+					QSKIP("Shader programs are not supported", SkipSingle);
+				}
+			}
+			queue->setFormat(format);
+
+			// Limited range colors: gray, then red on top of blue
+			const uchar colors[][2][3] = {
+				{ {126, 128, 128}, {126, 128, 128} },
+				{ {81, 90, 240}, {41, 240, 110} }
+			};
+			QMPYuvConverter converter;
+			for (int i = 0; i < 2; i++) {
+				const int cwidth = width / 2, cheight = height / 2;
+				QVector<uchar> yuv(width * height + 2 * cwidth * cheight);
+				unsigned char *planes[3];
+				planes[0] = yuv.data();
+				planes[1] = planes[0] + width * height;
+				planes[2] = planes[1] + cwidth * cheight;
+				for (int p = 0; p < 3; p++) {
+					const int w = (p == 0 ? width : cwidth), h = (p == 0 ? height : cheight);
+					for (int y = 0; y < h; y++) {
+						memset(planes[p] + y * w, colors[i][y < h / 2 ? 0 : 1][p], w);
+					}
+				}
+				QImage expected(width, height, QImage::Format_RGB32);
+				converter.convert(QMPYuvConverter::Layout420, planes, expected.bits(), expected.bytesPerLine(), width, height);
+
+				QMPFrame *frame = queue->acquire(width, height, cwidth, cheight);
+				QVERIFY(frame != NULL);
+				QCOMPARE(frame->format, format);
+				frame->time = -1;
+				if (format == QMPFrame::YuvFormat) {
+					memcpy(frame->plane(0), yuv.constData(), yuv.size());
+				} else {
+					frame->image = expected;
+				}
+				queue->publish(frame);
+
+				// The frame is presented by the scheduler and uploaded
+				for (int t = 0; t < 100 && widget.scheduler()->presentedFrames() < quint64(i + 1); t++) {
+					QTest::qWait(10);
+				}
+				QCOMPARE(widget.scheduler()->presentedFrames(), quint64(i + 1));
+
+				widget.updateGL();
+				QImage actual = widget.grabFrameBuffer();
+				QCOMPARE(actual.size(), expected.size());
+
+				// Sample the middle of both halves, away from the edge that
+				// is blurred by the linear texture filtering
+				const QPoint points[] = { QPoint(width / 2, height / 4), QPoint(width / 2, 3 * height / 4) };
+				for (int j = 0; j < 2; j++) {
+					QRgb e = expected.pixel(points[j]);
+					QRgb a = actual.pixel(points[j]);
+					if (qAbs(qRed(a) - qRed(e)) > 2 || qAbs(qGreen(a) - qGreen(e)) > 2 || qAbs(qBlue(a) - qBlue(e)) > 2) {
+						QFAIL(qPrintable(QString("Frame %1, pixel (%2, %3) differs: %4 != %5").arg(i).arg(points[j].x()).arg(points[j].y())
+							.arg(a & 0xFFFFFF, 6, 16).arg(e & 0xFFFFFF, 6, 16)));
+					}
+				}
+			}
+
+			widget.setFrameQueue(QSharedPointer<QMPFrameQueue>());
+		}
+};
+
+
+QTEST_MAIN(TestOpenGLWidget)
+
+#include "tst_openglwidget.moc"
@@ -0,0 +1,17 @@
+#
+#  qmpwidget - A Qt widget for embedding MPlayer
+#  Copyright (C) 2010 by Jonas Gehring
+#
+
+TEMPLATE = app
+TARGET = tst_statusline
+CONFIG += qtestlib
+
+QT += network opengl
+
+INCLUDEPATH += ../../src
+QMAKE_LIBDIR += ../..
+LIBS += -lqmpwidget
+
+HEADERS += ../../src/qmpoutputparser.h
+SOURCES += tst_statusline.cpp
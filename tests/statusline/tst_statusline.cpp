@@ -0,0 +1,82 @@
+/*
+ *  qmpwidget - A Qt widget for embedding MPlayer
+ *  Copyright (C) 2010 by Jonas Gehring
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <QtTest>
+
+#include "qmpoutputparser.h"
+
+
+// Checks and benchmarks the status line scanner
+class TestStatusLine : public QObject
+{
+	Q_OBJECT
+
+	private slots:
+		void scan()
+		{
+			const QByteArray line("A:  12.3 V:  12.4 A-V: -0.012 ct:  0.034  296/296  5%  2%  0.5% 3 4 50%");
+			QMPwidget::PlaybackStatus status;
+			QMPOutputParser::scanStatus(line.constData(), line.length(), &status);
+			QCOMPARE(status.audioPosition, 12.3);
+			QCOMPARE(status.videoPosition, 12.4);
+			QCOMPARE(status.audioVideoDelay, -0.012);
+			QCOMPARE(status.totalCorrection, 0.034);
+			QCOMPARE(status.playedFrames, 296);
+			QCOMPARE(status.decodedFrames, 296);
+			QCOMPARE(status.videoCodecUsage, 5.0);
+			QCOMPARE(status.videoOutputUsage, 2.0);
+			QCOMPARE(status.audioCodecUsage, 0.5);
+			QCOMPARE(status.droppedFrames, 3);
+			QCOMPARE(status.postprocessingLevel, 4);
+			QCOMPARE(status.cacheFill, 50);
+		}
+
+		void scanAudioOnly()
+		{
+			const QByteArray line("A:   2.3 (02.3) of 200.0 (03:20.0)  0.5%");
+			QMPwidget::PlaybackStatus status;
+			QMPOutputParser::scanStatus(line.constData(), line.length(), &status);
+			QCOMPARE(status.audioPosition, 2.3);
+			QCOMPARE(status.videoPosition, -1.0);
+			QCOMPARE(status.playedFrames, -1);
+			QCOMPARE(status.droppedFrames, -1);
+		}
+
+		void benchmark_data()
+		{
+			QTest::addColumn<QByteArray>("line");
+			QTest::newRow("video") << QByteArray("A:  12.3 V:  12.4 A-V: -0.012 ct:  0.034  296/296  5%  2%  0.5% 3 4 50%");
+			QTest::newRow("video without audio") << QByteArray("V:  12.4   296/296  5%  2%  0.0% 0 0");
+			QTest::newRow("audio") << QByteArray("A:   2.3 (02.3) of 200.0 (03:20.0)  0.5%");
+		}
+
+		void benchmark()
+		{
+			QFETCH(QByteArray, line);
+			QMPwidget::PlaybackStatus status;
+			QBENCHMARK {
+				QMPOutputParser::scanStatus(line.constData(), line.length(), &status);
+			}
+		}
+};
+
+
+QTEST_MAIN(TestStatusLine)
+
+#include "tst_statusline.moc"
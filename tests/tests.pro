@@ -0,0 +1,7 @@
+#
+#  qmpwidget - A Qt widget for embedding MPlayer
+#  Copyright (C) 2010 by Jonas Gehring
+#
+
+TEMPLATE = subdirs
+SUBDIRS += yuvconverter statusline openglwidget
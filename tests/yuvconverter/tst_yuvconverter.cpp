@@ -0,0 +1,149 @@
+/*
+ *  qmpwidget - A Qt widget for embedding MPlayer
+ *  Copyright (C) 2010 by Jonas Gehring
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <QtTest>
+
+#include "qmpyuvconverter.h"
+
+
+Q_DECLARE_METATYPE(QMPYuvConverter::Layout)
+Q_DECLARE_METATYPE(QMPYuvConverter::Kernel)
+
+
+// Compares the SIMD kernels to the reference implementation and measures
+// the throughput of the banded conversion
+class TestYuvConverter : public QObject
+{
+	Q_OBJECT
+
+	private slots:
+		void kernels_data()
+		{
+			QTest::addColumn<QMPYuvConverter::Kernel>("kernel");
+			QTest::addColumn<QMPYuvConverter::Layout>("layout");
+			QTest::addColumn<int>("width");
+			QTest::addColumn<int>("height");
+
+			const char *kernels[] = { "sse2", "avx2" };
+			const char *layouts[] = { "420", "422", "444" };
+			const int sizes[][2] = { {1, 1}, {2, 2}, {3, 5}, {15, 7}, {16, 16}, {17, 9}, {33, 31}, {127, 65}, {640, 360} };
+			for (int k = 0; k < 2; k++) {
+				for (int l = 0; l < 3; l++) {
+					for (unsigned int s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+						QByteArray name = QByteArray(kernels[k]) + " " + layouts[l] + " " + QByteArray::number(sizes[s][0]) + "x" + QByteArray::number(sizes[s][1]);
+						QTest::newRow(name.constData()) << QMPYuvConverter::Kernel(QMPYuvConverter::Sse2Kernel + k)
+							<< QMPYuvConverter::Layout(l) << sizes[s][0] << sizes[s][1];
+					}
+				}
+			}
+		}
+
+		void kernels()
+		{
+			QFETCH(QMPYuvConverter::Kernel, kernel);
+			QFETCH(QMPYuvConverter::Layout, layout);
+			QFETCH(int, width);
+			QFETCH(int, height);
+
+			QMPYuvConverter reference, converter;
+			QVERIFY(reference.setKernel(QMPYuvConverter::TablesKernel));
+			if (!converter.setKernel(kernel)) {
+				QSKIP("Kernel not supported", SkipSingle);
+			}
+
+			int cwidth = (layout == QMPYuvConverter::Layout444 ? width : (width + 1) / 2);
+			int cheight = (layout == QMPYuvConverter::Layout420 ? (height + 1) / 2 : height);
+			QByteArray data(width * height + 2 * cwidth * cheight, 0);
+			qsrand(width * 1000 + height);
+			for (int i = 0; i < data.size(); i++) {
+				data[i] = char(qrand() & 0xFF);
+			}
+			unsigned char *planes[3];
+			planes[0] = (unsigned char *)data.data();
+			planes[1] = planes[0] + width * height;
+			planes[2] = planes[1] + cwidth * cheight;
+
+			QImage expected(width, height, QImage::Format_RGB32);
+			QImage actual(width, height, QImage::Format_RGB32);
+			expected.fill(0);
+			actual.fill(0);
+			reference.convert(layout, planes, expected.bits(), expected.bytesPerLine(), width, height);
+			converter.convert(layout, planes, actual.bits(), actual.bytesPerLine(), width, height);
+
+			for (int y = 0; y < height; y++) {
+				const QRgb *e = (const QRgb *)expected.scanLine(y);
+				const QRgb *a = (const QRgb *)actual.scanLine(y);
+				for (int x = 0; x < width; x++) {
+					if (e[x] != a[x]) {
+						QFAIL(qPrintable(QString("Pixel (%1, %2) differs: %3 != %4").arg(x).arg(y).arg(a[x], 8, 16).arg(e[x], 8, 16)));
+					}
+				}
+			}
+		}
+
+		void bands_data()
+		{
+			QTest::addColumn<int>("threads");
+
+			// Thread counts beyond the number of cores show the overhead of
+			// oversubscription
+			const int max = qMax(4, QThread::idealThreadCount());
+			for (int threads = 1; threads <= max; threads++) {
+				QTest::newRow(QByteArray::number(threads).constData()) << threads;
+			}
+		}
+
+		// Converts a 1080p 4:2:0 frame with the given number of threads. The
+		// result is compared to the single-threaded conversion once, and the
+		// conversion itself is benchmarked.
+		void bands()
+		{
+			QFETCH(int, threads);
+
+			const int width = 1920, height = 1080;
+			QByteArray data(width * height * 3 / 2, 0);
+			qsrand(threads);
+			for (int i = 0; i < data.size(); i++) {
+				data[i] = char(qrand() & 0xFF);
+			}
+			unsigned char *planes[3];
+			planes[0] = (unsigned char *)data.data();
+			planes[1] = planes[0] + width * height;
+			planes[2] = planes[1] + width * height / 4;
+
+			QMPYuvConverter reference;
+			QImage expected(width, height, QImage::Format_RGB32);
+			reference.convert(QMPYuvConverter::Layout420, planes, expected.bits(), expected.bytesPerLine(), width, height);
+
+			QMPYuvBandConverter converter;
+			QImage actual(width, height, QImage::Format_RGB32);
+			actual.fill(0);
+			converter.convert(QMPYuvConverter::Layout420, planes, &actual, width, height, threads, false);
+			QVERIFY(actual == expected);
+
+			QBENCHMARK {
+				converter.convert(QMPYuvConverter::Layout420, planes, &actual, width, height, threads, false);
+			}
+		}
+};
+
+
+QTEST_MAIN(TestYuvConverter)
+
+#include "tst_yuvconverter.moc"
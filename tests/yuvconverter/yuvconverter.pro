@@ -0,0 +1,12 @@
+#
+#  qmpwidget - A Qt widget for embedding MPlayer
+#  Copyright (C) 2010 by Jonas Gehring
+#
+
+TEMPLATE = app
+TARGET = tst_yuvconverter
+CONFIG += qtestlib
+
+INCLUDEPATH += ../../src
+HEADERS += ../../src/qmpyuvconverter.h
+SOURCES += tst_yuvconverter.cpp